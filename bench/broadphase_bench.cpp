@@ -0,0 +1,173 @@
+// Compares the broadphase strategies PhysicsSystem can select on a side-scrolling level: a long
+// strip of floor and floating platforms with enemies, items and particles moving a little every
+// step. Checks that every strategy finds the same overlapping pairs.
+// Usage: broadphase_bench [steps]
+
+// stlib
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <vector>
+
+// internal
+#include "broadphase.hpp"
+
+using Clock = std::chrono::high_resolution_clock;
+
+namespace {
+
+const float step_seconds = 1.f / 60.f;
+const float level_height = 800.f;
+// Bodies per pixel of level length, roughly what a crowded screen holds
+const float bodies_per_px = 0.05f;
+// All pairs is quadratic, beyond this it takes seconds per step
+const size_t all_pairs_limit = 10000;
+
+struct Body
+{
+	vec2 position;
+	vec2 velocity;
+	vec2 scale;
+};
+
+double ms_since(Clock::time_point start)
+{
+	return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+}
+
+std::vector<Body> make_level(size_t n, std::default_random_engine& rng)
+{
+	float length = n / bodies_per_px;
+	std::uniform_real_distribution<float> along(0.f, length);
+	std::uniform_real_distribution<float> height(0.f, level_height);
+	std::uniform_real_distribution<float> speed(-120.f, 120.f);
+	std::uniform_real_distribution<float> size(20.f, 120.f);
+	std::uniform_real_distribution<float> platform_width(200.f, 600.f);
+
+	std::vector<Body> bodies;
+	for (size_t i = 0; i < n; i++)
+	{
+		Body body;
+		body.position = { along(rng), height(rng) };
+		if (i % 10 == 0)
+		{
+			// Platforms are wide and still
+			body.velocity = { 0.f, 0.f };
+			body.scale = { platform_width(rng), 40.f };
+		}
+		else
+		{
+			body.velocity = { speed(rng), speed(rng) };
+			body.scale = { size(rng), size(rng) };
+		}
+		bodies.push_back(body);
+	}
+	return bodies;
+}
+
+void move(std::vector<Body>& bodies)
+{
+	for (Body& body : bodies)
+	{
+		body.position += step_seconds * body.velocity;
+		// Bounce off the top and bottom of the level
+		if (body.position.y < 0.f || body.position.y > level_height)
+			body.velocity.y = -body.velocity.y;
+	}
+}
+
+void make_boxes(const std::vector<Body>& bodies, std::vector<AABB>& boxes)
+{
+	boxes.clear();
+	for (const Body& body : bodies)
+	{
+		vec2 half = { std::abs(body.scale.x) / 2.f, std::abs(body.scale.y) / 2.f };
+		boxes.push_back({ body.position - half, body.position + half });
+	}
+}
+
+bool overlap(const AABB& a, const AABB& b)
+{
+	return a.min.x <= b.max.x && b.min.x <= a.max.x && a.min.y <= b.max.y && b.min.y <= a.max.y;
+}
+
+// The pairs that survive the exact test, in a canonical order so strategies can be compared
+void exact_pairs(const std::vector<AABB>& boxes, const std::vector<BodyPair>& candidates, std::vector<BodyPair>& pairs)
+{
+	pairs.clear();
+	for (const BodyPair& pair : candidates)
+		if (overlap(boxes[pair.first], boxes[pair.second]))
+			pairs.push_back(pair);
+	std::sort(pairs.begin(), pairs.end());
+}
+
+struct Result
+{
+	double ms = 0;
+	size_t candidates = 0;
+};
+
+}
+
+int main(int argc, char* argv[])
+{
+	int steps = argc > 1 ? std::atoi(argv[1]) : 60;
+
+	AllPairs all_pairs;
+	SpatialHash spatial_hash;
+	SweepAndPrune sweep_and_prune;
+	Broadphase* strategies[broadphase_count] = { &all_pairs, &spatial_hash, &sweep_and_prune };
+
+	printf("%7s  %-16s %10s %12s\n", "bodies", "strategy", "ms/step", "candidates");
+	for (size_t n : { 100u, 500u, 1000u, 5000u, 10000u, 20000u })
+	{
+		std::default_random_engine rng(427);
+		std::vector<Body> start = make_level(n, rng);
+
+		Result results[broadphase_count];
+		std::vector<BodyPair> reference;
+		for (int s = 0; s < broadphase_count; s++)
+		{
+			BROADPHASE kind = (BROADPHASE)s;
+			if (kind == BROADPHASE::ALL_PAIRS && n > all_pairs_limit)
+				continue;
+
+			// Every strategy runs the same simulation, state from the previous size is dropped
+			std::vector<Body> bodies = start;
+			std::vector<AABB> boxes;
+			// Everything collides with everything, the layers are not what is measured here
+			std::vector<CollisionFilter> filters(bodies.size(), { ~0u, ~0u });
+			std::vector<unsigned int> ids(bodies.size());
+			for (unsigned int i = 0; i < ids.size(); i++)
+				ids[i] = i;
+			std::vector<BodyPair> candidates, pairs;
+			Broadphase& broadphase = *strategies[s];
+			if (kind == BROADPHASE::SWEEP_AND_PRUNE)
+				sweep_and_prune = SweepAndPrune();
+
+			for (int step = 0; step < steps; step++)
+			{
+				move(bodies);
+				make_boxes(bodies, boxes);
+				auto begin = Clock::now();
+				broadphase.find_pairs(boxes, filters, ids, candidates);
+				results[s].ms += ms_since(begin);
+				results[s].candidates += candidates.size();
+			}
+
+			exact_pairs(boxes, candidates, pairs);
+			if (reference.empty())
+				reference = pairs;
+			else if (pairs != reference)
+			{
+				fprintf(stderr, "%s disagrees at n=%zu: %zu vs %zu pairs\n", broadphase_name(kind), n, pairs.size(), reference.size());
+				return EXIT_FAILURE;
+			}
+			printf("%7zu  %-16s %10.3f %12zu\n", n, broadphase_name(kind), results[s].ms / steps, results[s].candidates / steps);
+		}
+	}
+	return EXIT_SUCCESS;
+}
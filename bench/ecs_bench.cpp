@@ -0,0 +1,195 @@
+// Compares the sparse-set ComponentContainer against the hash map based container it replaced.
+// First checks that churning entities doesn't grow the index space.
+// Usage: ecs_bench [repetitions]
+
+// stlib
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <algorithm>
+#include <random>
+#include <unordered_map>
+#include <vector>
+
+// internal
+#include "tiny_ecs.hpp"
+
+using Clock = std::chrono::high_resolution_clock;
+
+namespace {
+
+// The previous ComponentContainer, an unordered_map from entity to array index
+template <typename Component>
+class MapComponentContainer
+{
+	std::unordered_map<unsigned int, unsigned int> map_entity_componentID;
+public:
+	std::vector<Component> components;
+	std::vector<Entity> entities;
+
+	Component& insert(Entity e, Component c)
+	{
+		map_entity_componentID[e] = (unsigned int)components.size();
+		components.push_back(std::move(c));
+		entities.push_back(e);
+		return components.back();
+	}
+	Component& get(Entity e) { return components[map_entity_componentID[e]]; }
+	bool has(Entity e) { return map_entity_componentID.count(e) > 0; }
+	void remove(Entity e)
+	{
+		if (has(e))
+		{
+			int cID = map_entity_componentID[e];
+			components[cID] = std::move(components.back());
+			entities[cID] = entities.back();
+			map_entity_componentID[entities.back()] = cID;
+			map_entity_componentID.erase(e);
+			components.pop_back();
+			entities.pop_back();
+		}
+	}
+};
+
+// Roughly the size of a Motion component
+struct BenchComponent
+{
+	float data[9];
+};
+
+struct Timings
+{
+	double insert_ms = 0;
+	double has_ms = 0;
+	double get_ms = 0;
+	double remove_ms = 0;
+	float checksum = 0;
+};
+
+double ms_since(Clock::time_point start)
+{
+	return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+}
+
+// Mirrors what the systems do per frame: iterate one container and probe another by entity
+template <class Container>
+Timings run(const std::vector<Entity>& all, const std::vector<Entity>& probes, const std::vector<Entity>& removals)
+{
+	Timings t;
+	Container primary;
+	Container secondary;
+
+	auto start = Clock::now();
+	for (Entity e : all)
+		primary.insert(e, BenchComponent{});
+	for (size_t i = 0; i < all.size(); i += 2)
+		secondary.insert(all[i], BenchComponent{ { 1.f } });
+	t.insert_ms = ms_since(start);
+
+	start = Clock::now();
+	unsigned int hits = 0;
+	for (Entity e : probes)
+		hits += secondary.has(e) ? 1 : 0;
+	t.has_ms = ms_since(start);
+
+	start = Clock::now();
+	float sum = 0;
+	for (Entity e : primary.entities)
+	{
+		if (secondary.has(e))
+			sum += secondary.get(e).data[0];
+		sum += primary.get(e).data[1];
+	}
+	t.get_ms = ms_since(start);
+
+	start = Clock::now();
+	for (Entity e : removals)
+		primary.remove(e);
+	t.remove_ms = ms_since(start);
+
+	t.checksum = sum + (float)hits + (float)primary.entities.size();
+	return t;
+}
+
+// A few long lived entities and one that is created and destroyed over and over, e.g. a fireball
+// every frame, for longer than the generations of a single index last. The indices in use must
+// stay at the live entities plus the free queue.
+bool index_space_stays_flat()
+{
+	std::vector<Entity> live;
+	for (int i = 0; i < 100; i++)
+		live.push_back(Entity::create());
+	unsigned int capacity = 0;
+	for (unsigned int i = 0; i < 8 * Entity::min_free_indices * (Entity::max_generation + 1); i++)
+	{
+		Entity churned = Entity::create();
+		Entity::destroy(churned);
+		if (i == 2 * Entity::min_free_indices)
+			capacity = Entity::capacity();
+		else if (i > 2 * Entity::min_free_indices && Entity::capacity() != capacity)
+		{
+			fprintf(stderr, "Entity indices grew from %u to %u after %u creations\n", capacity, Entity::capacity(), i + 1);
+			return false;
+		}
+	}
+	for (Entity e : live)
+	{
+		if (!Entity::is_alive(e))
+		{
+			fprintf(stderr, "A live entity was invalidated by churn\n");
+			return false;
+		}
+		Entity::destroy(e);
+	}
+	printf("entity churn: %u indices for %zu live entities\n", capacity, live.size() + 1);
+	return true;
+}
+
+void report(const char* name, size_t n, const Timings& t)
+{
+	printf("%-8s %7zu  insert %8.3f ms  has %8.3f ms  iterate+get %8.3f ms  remove %8.3f ms\n",
+		name, n, t.insert_ms, t.has_ms, t.get_ms, t.remove_ms);
+}
+
+}
+
+int main(int argc, char* argv[])
+{
+	int repetitions = argc > 1 ? std::atoi(argv[1]) : 5;
+	std::default_random_engine rng(427);
+	if (!index_space_stays_flat())
+		return EXIT_FAILURE;
+
+	for (size_t n : { 1000u, 10000u, 100000u })
+	{
+		std::vector<Entity> all;
+		for (size_t i = 0; i < n; i++)
+			all.push_back(Entity::create());
+		std::vector<Entity> probes = all;
+		std::shuffle(probes.begin(), probes.end(), rng);
+		std::vector<Entity> removals(probes.begin(), probes.begin() + n / 2);
+
+		Timings best_map, best_sparse;
+		best_map.insert_ms = best_sparse.insert_ms = 1e30;
+		for (int r = 0; r < repetitions; r++)
+		{
+			Timings m = run<MapComponentContainer<BenchComponent>>(all, probes, removals);
+			Timings s = run<ComponentContainer<BenchComponent>>(all, probes, removals);
+			if (m.checksum != s.checksum)
+			{
+				fprintf(stderr, "Containers disagree: %f vs %f\n", m.checksum, s.checksum);
+				return EXIT_FAILURE;
+			}
+			if (m.insert_ms + m.has_ms + m.get_ms + m.remove_ms < best_map.insert_ms + best_map.has_ms + best_map.get_ms + best_map.remove_ms)
+				best_map = m;
+			if (s.insert_ms + s.has_ms + s.get_ms + s.remove_ms < best_sparse.insert_ms + best_sparse.has_ms + best_sparse.get_ms + best_sparse.remove_ms)
+				best_sparse = s;
+		}
+		report("map", n, best_map);
+		report("sparse", n, best_sparse);
+
+		for (Entity e : all)
+			Entity::destroy(e);
+	}
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,213 @@
+// Checks of the registry features the systems rely on, each one builds its own registry.
+// Usage: ecs_test
+
+// stlib
+#include <cassert>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+// internal
+#include "tiny_ecs.hpp"
+
+namespace {
+
+struct Position
+{
+	float x = 0;
+};
+
+struct Velocity
+{
+	float x = 0;
+};
+
+struct Hidden
+{
+};
+
+typedef Registry<Position, Velocity, Hidden> TestRegistry;
+
+void view_skips_excluded()
+{
+	TestRegistry registry;
+	Entity moving = Entity::create();
+	Entity still = Entity::create();
+	Entity hidden = Entity::create();
+	for (Entity e : { moving, still, hidden })
+		registry.storage<Position>().insert(e, { 1.f });
+	registry.storage<Velocity>().insert(moving, { 2.f });
+	registry.storage<Velocity>().insert(hidden, { 3.f });
+	registry.storage<Hidden>().emplace(hidden);
+
+	std::vector<Entity> visited;
+	auto view = registry.view<Position, Velocity>(exclude<Hidden>);
+	view.each([&](Entity e, Position& p, Velocity& v) {
+		assert(p.x == 1.f && v.x == 2.f);
+		visited.push_back(e);
+	});
+	assert(visited.size() == 1 && visited[0] == moving);
+	assert(view.contains(moving) && !view.contains(still) && !view.contains(hidden));
+
+	// Dropping the excluded component brings the entity into the view
+	registry.storage<Hidden>().remove(hidden);
+	auto unhidden = registry.view<Position, Velocity>(exclude<Hidden>);
+	assert(unhidden.contains(hidden));
+
+	for (Entity e : { moving, still, hidden })
+		registry.remove_all_components_of(e);
+}
+
+void playback_removes_destroys_then_adds()
+{
+	TestRegistry registry;
+	TestRegistry::Commands commands;
+	Entity replaced = Entity::create();
+	Entity doomed = Entity::create();
+	registry.storage<Position>().insert(replaced, { 1.f });
+	registry.storage<Position>().insert(doomed, { 1.f });
+
+	// Recorded adds before removes and destroys, played back in the other order
+	commands.add<Position>(replaced, { 2.f });
+	commands.remove<Position>(replaced);
+	commands.add<Velocity>(doomed, { 2.f });
+	commands.destroy(doomed);
+	Entity created = commands.create();
+	commands.add<Velocity>(created, { 3.f });
+	// Nothing is applied before playback
+	assert(registry.get<Position>(replaced).x == 1.f && registry.storage<Position>().has(doomed));
+	assert(!registry.storage<Velocity>().has(created));
+
+	commands.playback(registry);
+	assert(commands.empty());
+	// The removal ran first, the addition put the component back
+	assert(registry.get<Position>(replaced).x == 2.f);
+	// The destroyed entity lost its components, and nothing was added to it afterwards
+	assert(!Entity::is_alive(doomed));
+	assert(registry.storage<Position>().size() == 1 && registry.storage<Velocity>().size() == 1);
+	assert(registry.get<Velocity>(created).x == 3.f);
+
+	registry.remove_all_components_of(replaced);
+	registry.remove_all_components_of(created);
+}
+
+void sort_by_key_is_stable()
+{
+	TestRegistry registry;
+	ComponentContainer<Position>& positions = registry.storage<Position>();
+	std::vector<Entity> inserted;
+	// Keys 0 to 3 repeating, so every key is shared by several entities
+	for (int i = 0; i < 40; i++)
+	{
+		inserted.push_back(Entity::create());
+		positions.insert(inserted.back(), { (float)((i * 7) % 4) });
+	}
+	auto by_x = [](Entity, const Position& p) { return (uint64_t)p.x; };
+	positions.sort_by_key(by_x);
+
+	// Within a key the insertion order is kept
+	auto inserted_before = [&](Entity a, Entity b) {
+		for (Entity e : inserted)
+			if (e == a || e == b)
+				return e == a;
+		return false;
+	};
+	for (size_t i = 1; i < positions.size(); i++)
+	{
+		float previous = positions.components[i - 1].x;
+		float current = positions.components[i].x;
+		assert(previous <= current);
+		if (previous == current)
+			assert(inserted_before(positions.entities[i - 1], positions.entities[i]));
+	}
+	// The components moved with their entities
+	for (size_t i = 0; i < positions.size(); i++)
+		assert(&positions.get(positions.entities[i]) == &positions.components[i]);
+
+	for (Entity e : inserted)
+		registry.remove_all_components_of(e);
+}
+
+void group_follows_outside_changes()
+{
+	TestRegistry registry;
+	ComponentContainer<Position>& positions = registry.storage<Position>();
+	ComponentContainer<Velocity>& velocities = registry.storage<Velocity>();
+	Entity before = Entity::create();
+	positions.insert(before, { 1.f });
+	velocities.insert(before, { 1.f });
+	OwningGroup<Position, Velocity> group(positions, velocities);
+	assert(group.size() == 1);
+
+	// Components added and removed through the containers, not the group
+	std::vector<Entity> added;
+	for (int i = 0; i < 6; i++)
+	{
+		added.push_back(Entity::create());
+		positions.insert(added.back(), { (float)i });
+		if (i % 2 == 0)
+			velocities.insert(added.back(), { (float)i });
+	}
+	assert(group.size() == 4);
+	velocities.insert(added[1], { 1.f });
+	positions.remove(added[2]);
+	velocities.remove(before);
+	assert(group.size() == 3);
+
+	size_t members = 0;
+	group.each([&](Entity e, Position& p, Velocity& v) {
+		assert(positions.has(e) && velocities.has(e));
+		assert(&p == &positions.get(e) && &v == &velocities.get(e));
+		members++;
+	});
+	assert(members == group.size());
+	for (size_t i = 0; i < group.size(); i++)
+		assert(velocities.entities[i] == group.entities()[i]);
+	// Non-members sit behind the group in both containers
+	for (size_t i = group.size(); i < positions.size(); i++)
+		assert(!velocities.has(positions.entities[i]));
+
+	registry.remove_all_components_of(before);
+	for (Entity e : added)
+		registry.remove_all_components_of(e);
+	assert(group.size() == 0);
+}
+
+void tag_round_trip()
+{
+	TestRegistry registry;
+	ComponentContainer<Hidden>& hidden = registry.storage<Hidden>();
+	Entity first = Entity::create();
+	Entity second = Entity::create();
+	hidden.insert(first);
+	hidden.insert(second);
+	assert(hidden.has(first) && hidden.has(second) && hidden.size() == 2);
+	assert(registry.has_all<Hidden>(first));
+
+	hidden.remove(first);
+	assert(!hidden.has(first) && hidden.has(second));
+	assert(hidden.entities.size() == 1 && hidden.entities[0] == second);
+	assert(!registry.has_all<Hidden>(first));
+	hidden.insert(first);
+	assert(hidden.has(first) && hidden.size() == 2);
+
+	// Destroying the entity drops its tag
+	registry.remove_all_components_of(second);
+	assert(!hidden.has(second) && hidden.size() == 1);
+
+	registry.remove_all_components_of(first);
+	assert(hidden.size() == 0);
+}
+
+}
+
+int main()
+{
+	view_skips_excluded();
+	playback_removes_destroys_then_adds();
+	sort_by_key_is_stable();
+	group_follows_outside_changes();
+	tag_round_trip();
+	printf("ecs_test passed\n");
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,146 @@
+// Compares Motion stored as an array of structs (the previous std::vector<Motion>) against the
+// MotionStreams layout for what PhysicsSystem::step does every frame: integrate every body, then
+// test every body's bounding box.
+// Usage: motion_bench [repetitions]
+
+// stlib
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cmath>
+#include <random>
+#include <vector>
+
+// internal
+#include "motion.hpp"
+
+using Clock = std::chrono::high_resolution_clock;
+
+namespace {
+
+const float step_seconds = 1.f / 60.f;
+
+double ms_since(Clock::time_point start)
+{
+	return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+}
+
+bool overlaps(vec2 position1, vec2 scale1, vec2 position2, vec2 scale2)
+{
+	vec2 half1 = { std::abs(scale1.x) / 2.f, std::abs(scale1.y) / 2.f };
+	vec2 half2 = { std::abs(scale2.x) / 2.f, std::abs(scale2.y) / 2.f };
+	return std::abs(position1.x - position2.x) <= half1.x + half2.x
+		&& std::abs(position1.y - position2.y) <= half1.y + half2.y;
+}
+
+struct Result
+{
+	double ms = 1e30;
+	unsigned int hits = 0;
+	float checksum = 0;
+};
+
+// One step over all bodies: integration, then every body against the player's box
+Result step_aos(std::vector<Motion>& motions, vec2 player_position, vec2 player_scale)
+{
+	Result r;
+	auto start = Clock::now();
+	for (Motion& motion : motions)
+	{
+		motion.velocity += step_seconds * motion.acceleration;
+		motion.position += step_seconds * motion.velocity;
+	}
+	for (const Motion& motion : motions)
+		r.hits += overlaps(motion.position, motion.scale, player_position, player_scale);
+	r.ms = ms_since(start);
+	for (const Motion& motion : motions)
+		r.checksum += motion.position.x + motion.position.y;
+	return r;
+}
+
+Result step_soa(MotionStreams& motions, vec2 player_position, vec2 player_scale)
+{
+	Result r;
+	auto start = Clock::now();
+	for (size_t i = 0; i < motions.size(); i++)
+	{
+		motions.velocities[i] += step_seconds * motions.accelerations[i];
+		motions.positions[i] += step_seconds * motions.velocities[i];
+	}
+	for (size_t i = 0; i < motions.size(); i++)
+		r.hits += overlaps(motions.positions[i], motions.scales[i], player_position, player_scale);
+	r.ms = ms_since(start);
+	for (size_t i = 0; i < motions.size(); i++)
+		r.checksum += motions.positions[i].x + motions.positions[i].y;
+	return r;
+}
+
+// Bytes loaded per body and step, assuming the arrays don't fit in cache. With structs every
+// field shares the cache lines of the fields that are used, so each pass pulls in the whole struct.
+size_t aos_bytes_per_body()
+{
+	return 2 * sizeof(Motion);
+}
+
+size_t soa_bytes_per_body()
+{
+	size_t integration = 3 * sizeof(vec2); // accelerations, velocities, positions
+	size_t bounding_boxes = 2 * sizeof(vec2); // positions, scales
+	return integration + bounding_boxes;
+}
+
+void report(const char* name, size_t n, size_t bytes_per_body, const Result& r)
+{
+	double megabytes = double(bytes_per_body * n) / (1024.0 * 1024.0);
+	printf("%-8s n=%7zu  %6zu B/body  %8.3f MB/step  %8.3f ms/step  %6.2f GB/s\n",
+		name, n, bytes_per_body, megabytes, r.ms, megabytes / 1024.0 / (r.ms / 1000.0));
+}
+
+}
+
+int main(int argc, char* argv[])
+{
+	int repetitions = argc > 1 ? std::atoi(argv[1]) : 20;
+	std::default_random_engine rng(427);
+	std::uniform_real_distribution<float> coordinate(0.f, 2000.f);
+	std::uniform_real_distribution<float> extent(-100.f, 100.f);
+
+	const vec2 player_position = { 1000.f, 1000.f };
+	const vec2 player_scale = { -120.f, 120.f };
+
+	for (size_t n : { 1000u, 10000u, 100000u, 1000000u })
+	{
+		std::vector<Motion> aos;
+		MotionStreams soa;
+		for (size_t i = 0; i < n; i++)
+		{
+			Motion motion;
+			motion.position = { coordinate(rng), coordinate(rng) };
+			motion.velocity = { extent(rng), extent(rng) };
+			motion.acceleration = { 0.f, extent(rng) };
+			motion.scale = { extent(rng), extent(rng) };
+			motion.current_state = Motion::State::Idle;
+			aos.push_back(motion);
+			soa.push_back(motion);
+		}
+
+		Result best_aos, best_soa;
+		for (int r = 0; r < repetitions; r++)
+		{
+			Result a = step_aos(aos, player_position, player_scale);
+			Result s = step_soa(soa, player_position, player_scale);
+			if (a.hits != s.hits || a.checksum != s.checksum)
+			{
+				fprintf(stderr, "Layouts disagree: %u/%f vs %u/%f\n", a.hits, a.checksum, s.hits, s.checksum);
+				return EXIT_FAILURE;
+			}
+			if (a.ms < best_aos.ms)
+				best_aos = a;
+			if (s.ms < best_soa.ms)
+				best_soa = s;
+		}
+		report("structs", n, aos_bytes_per_body(), best_aos);
+		report("streams", n, soa_bytes_per_body(), best_soa);
+	}
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,150 @@
+// Compares collides() called pair by pair against the batch overlap kernels, one box tested
+// against many, and checks that every kernel finds exactly the boxes collides() finds. The
+// boxes include mirrored scales, boxes that only touch and NaN positions.
+// Usage: narrowphase_bench [repetitions]
+
+// stlib
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <limits>
+#include <random>
+#include <vector>
+
+// internal
+#include "narrowphase.hpp"
+
+using Clock = std::chrono::high_resolution_clock;
+
+namespace {
+
+struct Body
+{
+	vec2 position;
+	vec2 scale;
+};
+
+double ms_since(Clock::time_point start)
+{
+	return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+}
+
+std::vector<Body> make_bodies(size_t n, float world_size, std::default_random_engine& rng)
+{
+	std::uniform_real_distribution<float> coordinate(0.f, world_size);
+	std::uniform_real_distribution<float> extent(-120.f, 120.f);
+	std::vector<Body> bodies;
+	for (size_t i = 0; i < n; i++)
+		bodies.push_back({ { coordinate(rng), coordinate(rng) }, { extent(rng), extent(rng) } });
+	return bodies;
+}
+
+// Exact edge cases for the query body at the origin with a 100 x 100 box
+void add_edge_cases(std::vector<Body>& bodies)
+{
+	const float nan = std::numeric_limits<float>::quiet_NaN();
+	bodies.push_back({ { 100.f, 0.f }, { 100.f, 100.f } }); // touches on the right
+	bodies.push_back({ { 0.f, -100.f }, { -100.f, 100.f } }); // touches on top, mirrored
+	bodies.push_back({ { 100.f, 100.f }, { 100.f, -100.f } }); // touches a corner
+	bodies.push_back({ { 100.5f, 0.f }, { 100.f, 100.f } }); // just apart
+	bodies.push_back({ { 0.f, 0.f }, { 0.f, 0.f } }); // a point in the middle
+	bodies.push_back({ { nan, 0.f }, { 10.f, 10.f } });
+	bodies.push_back({ { 0.f, 0.f }, { nan, nan } });
+}
+
+void reference(const Body& query, const std::vector<Body>& bodies, std::vector<unsigned int>& hits)
+{
+	hits.clear();
+	for (unsigned int i = 0; i < bodies.size(); i++)
+		if (collides(query.position, query.scale, bodies[i].position, bodies[i].scale))
+			hits.push_back(i);
+}
+
+}
+
+int main(int argc, char* argv[])
+{
+	int repetitions = argc > 1 ? std::atoi(argv[1]) : 200;
+	std::default_random_engine rng(427);
+
+	printf("best level on this CPU: %s\n", simd_level_name(best_simd_level()));
+	printf("%8s  %-10s %10s %10s\n", "boxes", "kernel", "ns/box", "speedup");
+	for (size_t n : { 64u, 1000u, 10000u, 100000u })
+	{
+		// About as crowded as a level, a query hits a few percent of the boxes
+		std::vector<Body> bodies = make_bodies(n, 4000.f, rng);
+		add_edge_cases(bodies);
+		std::vector<Body> queries = make_bodies(64, 4000.f, rng);
+		queries[0] = { { 0.f, 0.f }, { 100.f, -100.f } };
+
+		AABBStreams boxes;
+		for (const Body& body : bodies)
+			boxes.push_back(get_aabb(body.position, body.scale));
+
+		// Correctness: every query against every box, then one range that doesn't start at 0
+		std::vector<unsigned int> expected, hits(bodies.size());
+		for (SIMD_LEVEL level = SIMD_LEVEL::SCALAR; level != SIMD_LEVEL::SIMD_LEVEL_COUNT; level = (SIMD_LEVEL)((int)level + 1))
+		{
+			OverlapBatch kernel = overlap_batch_kernel(level);
+			if (!kernel)
+				continue;
+			for (const Body& query : queries)
+			{
+				reference(query, bodies, expected);
+				AABB box = get_aabb(query.position, query.scale);
+				size_t count = kernel(box, boxes, 0, bodies.size(), hits.data());
+				bool same = count == expected.size();
+				for (size_t k = 0; same && k < count; k++)
+					same = hits[k] == expected[k];
+
+				size_t begin = bodies.size() / 3;
+				size_t offset_count = kernel(box, boxes, begin, bodies.size(), hits.data());
+				size_t offset_expected = 0;
+				for (unsigned int i : expected)
+					offset_expected += i >= begin;
+				same = same && offset_count == offset_expected;
+
+				if (!same)
+				{
+					fprintf(stderr, "%s disagrees with collides() at n=%zu\n", simd_level_name(level), n);
+					return EXIT_FAILURE;
+				}
+			}
+		}
+
+		// Timing: every query against every box, best of the repetitions
+		size_t tests = queries.size() * bodies.size();
+		double best_reference = 1e30;
+		volatile size_t sink = 0;
+		for (int r = 0; r < repetitions; r++)
+		{
+			auto start = Clock::now();
+			for (const Body& query : queries)
+			{
+				reference(query, bodies, expected);
+				sink = sink + expected.size();
+			}
+			best_reference = std::min(best_reference, ms_since(start));
+		}
+		printf("%8zu  %-10s %10.3f %10s\n", bodies.size(), "collides", best_reference * 1e6 / tests, "1.00");
+
+		for (SIMD_LEVEL level = SIMD_LEVEL::SCALAR; level != SIMD_LEVEL::SIMD_LEVEL_COUNT; level = (SIMD_LEVEL)((int)level + 1))
+		{
+			OverlapBatch kernel = overlap_batch_kernel(level);
+			if (!kernel)
+				continue;
+			double best = 1e30;
+			for (int r = 0; r < repetitions; r++)
+			{
+				auto start = Clock::now();
+				for (const Body& query : queries)
+					sink = sink + kernel(get_aabb(query.position, query.scale), boxes, 0, bodies.size(), hits.data());
+				best = std::min(best, ms_since(start));
+			}
+			printf("%8zu  %-10s %10.3f %10.2f\n", bodies.size(), simd_level_name(level), best * 1e6 / tests, best_reference / best);
+		}
+	}
+	return EXIT_SUCCESS;
+}
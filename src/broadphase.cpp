@@ -0,0 +1,307 @@
+// internal
+#include "broadphase.hpp"
+#include "narrowphase.hpp"
+
+// stlib
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <glm/common.hpp>
+
+const unsigned int SweepAndPrune::null_body;
+
+const char* broadphase_name(BROADPHASE kind)
+{
+	switch (kind)
+	{
+	case BROADPHASE::ALL_PAIRS:
+		return "all pairs";
+	case BROADPHASE::SPATIAL_HASH:
+		return "spatial hash";
+	case BROADPHASE::SWEEP_AND_PRUNE:
+		return "sweep and prune";
+	default:
+		return "unknown";
+	}
+}
+
+// Inclusive, boxes that touch overlap, as in collides()
+static bool overlap(const AABB& a, const AABB& b)
+{
+	return a.min.x <= b.max.x && b.min.x <= a.max.x && a.min.y <= b.max.y && b.min.y <= a.max.y;
+}
+
+bool segment_aabb(vec2 origin, vec2 direction, const AABB& box, float& time)
+{
+	// The segment is inside the box where it is between both pairs of opposite faces
+	float enter = 0.f;
+	float leave = 1.f;
+	for (int axis = 0; axis < 2; axis++)
+	{
+		float d = direction[axis];
+		if (d == 0.f)
+		{
+			if (origin[axis] < box.min[axis] || box.max[axis] < origin[axis])
+				return false;
+			continue;
+		}
+		float t0 = (box.min[axis] - origin[axis]) / d;
+		float t1 = (box.max[axis] - origin[axis]) / d;
+		if (t0 > t1)
+			std::swap(t0, t1);
+		enter = std::max(enter, t0);
+		leave = std::min(leave, t1);
+		if (enter > leave)
+			return false;
+	}
+	time = enter;
+	return true;
+}
+
+void AllPairs::find_pairs(const std::vector<AABB>& boxes, const std::vector<CollisionFilter>& filters, const std::vector<unsigned int>&, std::vector<BodyPair>& pairs)
+{
+	assert(filters.size() == boxes.size());
+	pairs.clear();
+	for (unsigned int i = 0; i < boxes.size(); i++)
+		for (unsigned int j = i + 1; j < boxes.size(); j++)
+			if (should_collide(filters[i], filters[j]) && overlap(boxes[i], boxes[j]))
+				pairs.push_back({ i, j });
+}
+
+// Cell coordinates are clamped to this range, far beyond any level, so the conversion can't overflow
+const float max_cell_coordinate = float(1 << 24);
+
+SpatialHash::SpatialHash(float cell_size)
+{
+	set_cell_size(cell_size);
+}
+
+void SpatialHash::set_cell_size(float size)
+{
+	assert(size > 0.f);
+	cell_size = size;
+	inverse_cell_size = 1.f / size;
+}
+
+uint32_t SpatialHash::hash(int x, int y)
+{
+	return ((uint32_t)x * 73856093u) ^ ((uint32_t)y * 19349663u);
+}
+
+SpatialHash::CellRange SpatialHash::cells_of(const AABB& box) const
+{
+	auto cell = [this](float coordinate) {
+		// Converting NaN to int is undefined, a box with NaN coordinates lands in cell 0
+		if (std::isnan(coordinate))
+			return 0;
+		float c = std::floor(coordinate * inverse_cell_size);
+		return (int)std::min(std::max(c, -max_cell_coordinate), max_cell_coordinate);
+	};
+	return { cell(box.min.x), cell(box.min.y), cell(box.max.x), cell(box.max.y) };
+}
+
+void SpatialHash::find_pairs(const std::vector<AABB>& boxes, const std::vector<CollisionFilter>& filters, const std::vector<unsigned int>&, std::vector<BodyPair>& pairs)
+{
+	assert(filters.size() == boxes.size());
+	pairs.clear();
+	entries.clear();
+	ranges.resize(boxes.size());
+
+	// One entry per covered cell and body
+	for (unsigned int body = 0; body < boxes.size(); body++)
+	{
+		CellRange range = cells_of(boxes[body]);
+		ranges[body] = range;
+		for (int y = range.y0; y <= range.y1; y++)
+			for (int x = range.x0; x <= range.x1; x++)
+				entries.push_back({ x, y, body });
+	}
+	if (entries.empty())
+		return;
+
+	// Counting sort of the entries by hash bucket, a power of two at least as large as the entry count
+	size_t bucket_count = 16;
+	while (bucket_count < entries.size())
+		bucket_count *= 2;
+	uint32_t bucket_mask = (uint32_t)bucket_count - 1;
+
+	bucket_starts.assign(bucket_count + 1, 0);
+	for (const Entry& entry : entries)
+		bucket_starts[(hash(entry.x, entry.y) & bucket_mask) + 1]++;
+	for (size_t bucket = 1; bucket <= bucket_count; bucket++)
+		bucket_starts[bucket] += bucket_starts[bucket - 1];
+	bucketed.resize(entries.size());
+	for (const Entry& entry : entries)
+		bucketed[bucket_starts[hash(entry.x, entry.y) & bucket_mask]++] = entry;
+	// bucket_starts[b] now is the end of bucket b
+
+	unsigned int begin = 0;
+	for (size_t bucket = 0; bucket < bucket_count; bucket++)
+	{
+		unsigned int end = bucket_starts[bucket];
+		for (unsigned int a = begin; a < end; a++)
+		{
+			const Entry& entry_a = bucketed[a];
+			for (unsigned int b = a + 1; b < end; b++)
+			{
+				const Entry& entry_b = bucketed[b];
+				// Different cells can hash to the same bucket
+				if (entry_a.x != entry_b.x || entry_a.y != entry_b.y)
+					continue;
+				unsigned int first = std::min(entry_a.body, entry_b.body);
+				unsigned int second = std::max(entry_a.body, entry_b.body);
+				// Report the pair only from the top-left cell of the two cell ranges' overlap
+				const CellRange& range_first = ranges[first];
+				const CellRange& range_second = ranges[second];
+				if (entry_a.x == std::max(range_first.x0, range_second.x0) && entry_a.y == std::max(range_first.y0, range_second.y0)
+					&& should_collide(filters[first], filters[second]))
+					pairs.push_back({ first, second });
+			}
+		}
+		begin = end;
+	}
+}
+
+void SweepAndPrune::update_endpoints(const std::vector<AABB>& boxes, const std::vector<unsigned int>& ids)
+{
+	assert(ids.size() == boxes.size());
+	unsigned int count = (unsigned int)boxes.size();
+	for (unsigned int body = 0; body < count; body++)
+	{
+		if (ids[body] >= body_of_id.size())
+			body_of_id.resize(ids[body] + 1, null_body);
+		assert(body_of_id[ids[body]] == null_body && "Broadphase ids must be unique");
+		body_of_id[ids[body]] = body;
+	}
+
+	// Drop the bodies that are gone and find where the others are now, they keep their place. Each
+	// id is cleared once it is claimed, the ones left over are new and appended.
+	size_t kept = 0;
+	for (const Endpoint& endpoint : endpoints)
+	{
+		if (endpoint.id >= body_of_id.size() || body_of_id[endpoint.id] == null_body)
+			continue;
+		endpoints[kept] = endpoint;
+		endpoints[kept++].body = body_of_id[endpoint.id];
+		body_of_id[endpoint.id] = null_body;
+	}
+	endpoints.resize(kept);
+	for (unsigned int body = 0; body < count; body++)
+	{
+		if (body_of_id[ids[body]] == null_body)
+			continue;
+		endpoints.push_back({ 0.f, body, ids[body] });
+		body_of_id[ids[body]] = null_body;
+	}
+	for (Endpoint& endpoint : endpoints)
+		endpoint.min_x = boxes[endpoint.body].min.x;
+
+	// Insertion sort, giving up once it moved more elements than a full sort would roughly cost
+	size_t budget = 4 * endpoints.size() + 64;
+	size_t moves = 0;
+	for (size_t i = 1; i < endpoints.size(); i++)
+	{
+		Endpoint endpoint = endpoints[i];
+		size_t j = i;
+		while (j > 0 && endpoints[j - 1].min_x > endpoint.min_x)
+		{
+			endpoints[j] = endpoints[j - 1];
+			j--;
+		}
+		endpoints[j] = endpoint;
+		moves += i - j;
+		if (moves > budget)
+		{
+			std::sort(endpoints.begin(), endpoints.end(), [](const Endpoint& a, const Endpoint& b) {
+				return a.min_x < b.min_x;
+			});
+			return;
+		}
+	}
+}
+
+void SweepAndPrune::find_pairs(const std::vector<AABB>& boxes, const std::vector<CollisionFilter>& filters, const std::vector<unsigned int>& ids, std::vector<BodyPair>& pairs)
+{
+	assert(filters.size() == boxes.size());
+	pairs.clear();
+	update_endpoints(boxes, ids);
+	sorted.clear();
+	for (const Endpoint& endpoint : endpoints)
+		sorted.push_back(boxes[endpoint.body]);
+	hits.resize(endpoints.size());
+
+	for (size_t i = 0; i < endpoints.size(); i++)
+	{
+		const AABB& box = boxes[endpoints[i].body];
+		// Every box after this one starts at or after its left edge, the candidates end at the first that
+		// starts past its right edge. Runs are short, a scan beats bisection's mispredicted branches.
+		size_t end = i + 1;
+		while (end < endpoints.size() && sorted.min_x[end] <= box.max.x)
+			end++;
+		size_t count = overlap_batch(box, sorted, i + 1, end, hits.data());
+		for (size_t k = 0; k < count; k++)
+		{
+			unsigned int a = endpoints[i].body;
+			unsigned int b = endpoints[hits[k]].body;
+			if (should_collide(filters[a], filters[b]))
+				pairs.push_back({ std::min(a, b), std::max(a, b) });
+		}
+	}
+}
+
+bool AABBTree::overlap(const AABB& a, const AABB& b)
+{
+	return ::overlap(a, b);
+}
+
+void AABBTree::clear()
+{
+	nodes.clear();
+}
+
+void AABBTree::build(const std::vector<AABB>& boxes)
+{
+	nodes.clear();
+	if (boxes.empty())
+		return;
+	nodes.reserve(2 * boxes.size() - 1);
+	order.resize(boxes.size());
+	for (unsigned int i = 0; i < boxes.size(); i++)
+		order[i] = i;
+	build_range(boxes, 0, boxes.size());
+}
+
+int AABBTree::build_range(const std::vector<AABB>& boxes, size_t begin, size_t end)
+{
+	int index = (int)nodes.size();
+	nodes.emplace_back();
+
+	AABB bounds = boxes[order[begin]];
+	for (size_t i = begin + 1; i < end; i++)
+	{
+		bounds.min = glm::min(bounds.min, boxes[order[i]].min);
+		bounds.max = glm::max(bounds.max, boxes[order[i]].max);
+	}
+	nodes[index].box = bounds;
+
+	if (end - begin == 1)
+	{
+		nodes[index].body = order[begin];
+		return index;
+	}
+
+	// Split at the median center along the longer side
+	int axis = bounds.max.x - bounds.min.x >= bounds.max.y - bounds.min.y ? 0 : 1;
+	size_t middle = begin + (end - begin) / 2;
+	std::nth_element(order.begin() + begin, order.begin() + middle, order.begin() + end,
+		[&boxes, axis](unsigned int a, unsigned int b) {
+			return boxes[a].min[axis] + boxes[a].max[axis] < boxes[b].min[axis] + boxes[b].max[axis];
+		});
+
+	// nodes may reallocate while the children are built, so don't hold a reference across
+	int left = build_range(boxes, begin, middle);
+	int right = build_range(boxes, middle, end);
+	nodes[index].left = left;
+	nodes[index].right = right;
+	return index;
+}
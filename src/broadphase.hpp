@@ -0,0 +1,266 @@
+#pragma once
+
+#include <vector>
+#include <utility>
+#include <cassert>
+#include <cstdint>
+#include <glm/vec2.hpp>
+
+using glm::vec2;
+
+// An axis-aligned box given by its corners, min <= max
+struct AABB
+{
+	vec2 min;
+	vec2 max;
+};
+
+// Where the segment from 'origin' to 'origin + direction' first touches 'box', as a fraction of its
+// length in [0, 1], 0 if it starts inside. False if it misses, touching counts as a hit.
+bool segment_aabb(vec2 origin, vec2 direction, const AABB& box, float& time);
+
+// Boxes laid out as one array per extent, so that a kernel can load the same extent of several
+// boxes at once
+class AABBStreams
+{
+public:
+	std::vector<float> min_x;
+	std::vector<float> min_y;
+	std::vector<float> max_x;
+	std::vector<float> max_y;
+
+	void push_back(const AABB& box)
+	{
+		min_x.push_back(box.min.x);
+		min_y.push_back(box.min.y);
+		max_x.push_back(box.max.x);
+		max_y.push_back(box.max.y);
+	}
+
+	void clear()
+	{
+		min_x.clear();
+		min_y.clear();
+		max_x.clear();
+		max_y.clear();
+	}
+
+	size_t size() const
+	{
+		return min_x.size();
+	}
+};
+
+// A pair of indices into the boxes handed to a broadphase, first < second
+typedef std::pair<unsigned int, unsigned int> BodyPair;
+
+// Which bodies may collide, a pair is only reported when each body is on a layer the other collides with
+struct CollisionFilter
+{
+	uint32_t category = 0; // bits of the layers this body is on
+	uint32_t mask = 0; // bits of the layers it collides with
+};
+
+inline bool should_collide(const CollisionFilter& a, const CollisionFilter& b)
+{
+	return (a.category & b.mask) != 0 && (b.category & a.mask) != 0;
+}
+
+// The available broadphase strategies, see PhysicsSystem::set_broadphase
+enum class BROADPHASE {
+	ALL_PAIRS = 0,
+	SPATIAL_HASH = ALL_PAIRS + 1,
+	SWEEP_AND_PRUNE = SPATIAL_HASH + 1,
+	BROADPHASE_COUNT = SWEEP_AND_PRUNE + 1
+};
+const int broadphase_count = (int)BROADPHASE::BROADPHASE_COUNT;
+
+const char* broadphase_name(BROADPHASE kind);
+
+// Finds the pairs of boxes that may overlap, so that the exact test only runs on those
+class Broadphase
+{
+public:
+	virtual ~Broadphase() {}
+
+	// Replaces 'pairs' with the candidate pairs among 'boxes', every pair is reported once. Pairs
+	// that 'filters' (one per box) reject are left out before any exact test is done. 'ids' has a
+	// small number per box that stays with its body from call to call, unique among the boxes, e.g.
+	// the entity index. Strategies that keep state between calls recognize the bodies by it.
+	virtual void find_pairs(const std::vector<AABB>& boxes, const std::vector<CollisionFilter>& filters, const std::vector<unsigned int>& ids, std::vector<BodyPair>& pairs) = 0;
+};
+
+// Tests every pair of boxes, quadratic. The reference the other strategies are measured against.
+class AllPairs : public Broadphase
+{
+public:
+	void find_pairs(const std::vector<AABB>& boxes, const std::vector<CollisionFilter>& filters, const std::vector<unsigned int>& ids, std::vector<BodyPair>& pairs) override;
+};
+
+// Boxes are bucketed into the cells of a uniform grid they cover, a pair is a candidate if the two
+// boxes share a cell. The grid is hashed, so the world needs no bounds, and it is rebuilt from
+// scratch on every call into buffers that are kept, which is linear in the number of covered cells.
+// Every candidate pair is reported exactly once: only the first cell two boxes share reports it.
+class SpatialHash : public Broadphase
+{
+public:
+	// Cells should be about the size of a typical body, much smaller cells make large bodies cover
+	// many of them, much larger cells put many unrelated bodies into the same one
+	explicit SpatialHash(float cell_size = 128.f);
+
+	void set_cell_size(float size);
+	float get_cell_size() const { return cell_size; }
+
+	void find_pairs(const std::vector<AABB>& boxes, const std::vector<CollisionFilter>& filters, const std::vector<unsigned int>& ids, std::vector<BodyPair>& pairs) override;
+
+private:
+	struct CellRange
+	{
+		int x0, y0, x1, y1;
+	};
+
+	struct Entry
+	{
+		int x, y;
+		unsigned int body;
+	};
+
+	float cell_size;
+	float inverse_cell_size;
+
+	// Kept between calls so that a step does not allocate once the buffers have grown
+	std::vector<CellRange> ranges;
+	std::vector<Entry> entries;
+	std::vector<Entry> bucketed;
+	std::vector<unsigned int> bucket_starts;
+
+	CellRange cells_of(const AABB& box) const;
+	static uint32_t hash(int x, int y);
+};
+
+// Sorts the boxes by their left edge and sweeps along x: a box only needs to be tested against the
+// boxes that start before its right edge. The sorted endpoint list is kept between calls and
+// re-sorted with insertion sort, which is close to linear when the bodies moved little since the
+// last step, as is the case in a level that scrolls sideways. Bodies are recognized by their ids, so
+// the others keep their place in the list when a body is added or removed and the boxes handed in
+// shift. When the order changed a lot, e.g. after a level was rebuilt, the insertion sort gives up
+// and a full sort is done instead.
+// The boxes a box can overlap are tested with overlap_batch.
+class SweepAndPrune : public Broadphase
+{
+public:
+	void find_pairs(const std::vector<AABB>& boxes, const std::vector<CollisionFilter>& filters, const std::vector<unsigned int>& ids, std::vector<BodyPair>& pairs) override;
+
+private:
+	struct Endpoint
+	{
+		float min_x; // cached left edge of the body, so sorting doesn't chase the body index
+		unsigned int body; // position in this call's boxes
+		unsigned int id;
+	};
+
+	std::vector<Endpoint> endpoints;
+	AABBStreams sorted; // the boxes in endpoint order, for the batch overlap test
+	std::vector<unsigned int> hits;
+	// body_of_id[id] is the position of the box with that id while the endpoints are updated, and
+	// null_body otherwise
+	std::vector<unsigned int> body_of_id;
+	static const unsigned int null_body = ~0u;
+
+	void update_endpoints(const std::vector<AABB>& boxes, const std::vector<unsigned int>& ids);
+};
+
+// Bounding volume hierarchy over bodies that don't move, such as platforms and walls. Built top down
+// in one go, splitting the boxes at the median of the longer axis of their bounds, which keeps the
+// tree balanced. Moving bodies query it instead of being paired with every static body, and static
+// bodies are never tested against each other.
+class AABBTree
+{
+public:
+	// Replaces the tree with one over 'boxes', a query reports positions in this array
+	void build(const std::vector<AABB>& boxes);
+	void clear();
+	bool empty() const { return nodes.empty(); }
+
+	// Calls 'callback(index)' for every box that overlaps 'box', touching counts. Queries don't change
+	// the tree and can run on several threads at once.
+	template <typename Callback>
+	void query(const AABB& box, Callback callback) const;
+	// Calls 'callback(index, time)' for every box the segment from 'origin' to 'origin + direction'
+	// touches, 'time' being where along it, as in segment_aabb. The callback returns how much of the
+	// segment is still searched: its 'time' to only look for nearer boxes, 1 to find all of them.
+	template <typename Callback>
+	void raycast(vec2 origin, vec2 direction, Callback callback) const;
+
+private:
+	struct Node
+	{
+		AABB box;
+		// Leaves have no children and refer to a box, inner nodes have two children
+		int left = -1;
+		int right = -1;
+		unsigned int body = 0;
+	};
+
+	std::vector<Node> nodes; // the root is nodes[0]
+	std::vector<unsigned int> order; // box indices, partitioned in place while building
+	// Median splits keep the tree balanced, a query's stack never holds more than one node per level
+	static const int max_stack = 64;
+
+	int build_range(const std::vector<AABB>& boxes, size_t begin, size_t end);
+	static bool overlap(const AABB& a, const AABB& b);
+};
+
+template <typename Callback>
+void AABBTree::query(const AABB& box, Callback callback) const
+{
+	if (nodes.empty())
+		return;
+	int stack[max_stack];
+	int top = 0;
+	stack[top++] = 0;
+	while (top > 0)
+	{
+		const Node& node = nodes[stack[--top]];
+		if (!overlap(node.box, box))
+			continue;
+		if (node.left < 0)
+			callback(node.body);
+		else
+		{
+			assert(top + 2 <= max_stack);
+			stack[top++] = node.left;
+			stack[top++] = node.right;
+		}
+	}
+}
+
+template <typename Callback>
+void AABBTree::raycast(vec2 origin, vec2 direction, Callback callback) const
+{
+	if (nodes.empty())
+		return;
+	float max_time = 1.f;
+	int stack[max_stack];
+	int top = 0;
+	stack[top++] = 0;
+	while (top > 0)
+	{
+		const Node& node = nodes[stack[--top]];
+		float time;
+		if (!segment_aabb(origin, direction, node.box, time) || time > max_time)
+			continue;
+		if (node.left < 0)
+		{
+			float keep = callback(node.body, time);
+			if (keep < max_time)
+				max_time = keep;
+		}
+		else
+		{
+			assert(top + 2 <= max_stack);
+			stack[top++] = node.left;
+			stack[top++] = node.right;
+		}
+	}
+}
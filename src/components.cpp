@@ -6,6 +6,8 @@
 #include "../ext/stb_image/stb_image.h"
 
 // stlib
+#include <algorithm>
+#include <cmath>
 #include <iostream>
 #include <sstream>
 
@@ -13,6 +15,26 @@ Debug debugging;
 Help help;
 float death_timer_counter_ms = 3000;
 
+// The layers each layer collides with, symmetric. Only pairs handle_collisions reacts to are in here:
+// the player runs into enemies and picks up items. Falling bodies are kept out of platforms by the
+// physics system's sweep, which doesn't need contacts, so the world layer reports none. UI buttons
+// are on a layer of their own but collide with nothing, on_mouse_input finds the clicked one with a
+// point query. Entities without a filter, such as backgrounds, don't collide at all.
+CollisionFilter collision_filter(COLLISION_LAYER layer)
+{
+	static const uint32_t masks[collision_layer_count] = {
+		0, // WORLD
+		layer_bit(COLLISION_LAYER::ENEMY) | layer_bit(COLLISION_LAYER::ITEM), // PLAYER
+		layer_bit(COLLISION_LAYER::PLAYER), // ENEMY
+		layer_bit(COLLISION_LAYER::PLAYER), // ITEM
+		0, // UI
+	};
+	CollisionFilter filter;
+	filter.category = layer_bit(layer);
+	filter.mask = masks[(int)layer];
+	return filter;
+}
+
 
 // Very, VERY simple OBJ loader from https://github.com/opengl-tutorials/ogl tutorial 7
 // (modified to also read vertex color and omit uv and normals)
@@ -109,3 +131,65 @@ bool Mesh::loadFromOBJFile(std::string obj_path, std::vector<ColoredVertex>& out
 	return true;
 }
 
+// Twice the signed area of the triangle o, a, b, positive if it turns counter-clockwise
+static float cross(vec2 o, vec2 a, vec2 b)
+{
+	return (a.x - o.x) * (b.y - o.y) - (a.y - o.y) * (b.x - o.x);
+}
+
+void Mesh::computeCollisionHull(const std::vector<ColoredVertex>& vertices, std::vector<vec2>& out_hull)
+{
+	out_hull.clear();
+	std::vector<vec2> points;
+	points.reserve(vertices.size());
+	for (const ColoredVertex& vertex : vertices)
+		points.push_back({ vertex.position.x, vertex.position.y });
+	std::sort(points.begin(), points.end(), [](vec2 a, vec2 b) {
+		return a.x < b.x || (a.x == b.x && a.y < b.y);
+	});
+	points.erase(std::unique(points.begin(), points.end()), points.end());
+	if (points.size() < 3)
+	{
+		out_hull = points;
+		return;
+	}
+
+	// Monotone chain: the lower hull left to right, then the upper hull right to left
+	std::vector<vec2> hull(2 * points.size());
+	size_t k = 0;
+	for (size_t i = 0; i < points.size(); i++)
+	{
+		while (k >= 2 && cross(hull[k - 2], hull[k - 1], points[i]) <= 0.f)
+			k--;
+		hull[k++] = points[i];
+	}
+	for (size_t i = points.size() - 1, lower = k + 1; i-- > 0;)
+	{
+		while (k >= lower && cross(hull[k - 2], hull[k - 1], points[i]) <= 0.f)
+			k--;
+		hull[k++] = points[i];
+	}
+	hull.resize(k - 1); // the last point is the first one again
+
+	// Drop the point whose triangle with its neighbours is smallest until few enough are left,
+	// this shaves off the least area, so the hull stays close to the mesh outline
+	while (hull.size() > max_collision_hull_points)
+	{
+		size_t smallest = 0;
+		float smallest_area = INFINITY;
+		for (size_t i = 0; i < hull.size(); i++)
+		{
+			vec2 previous = hull[(i + hull.size() - 1) % hull.size()];
+			vec2 next = hull[(i + 1) % hull.size()];
+			float area = cross(previous, hull[i], next);
+			if (area < smallest_area)
+			{
+				smallest_area = area;
+				smallest = i;
+			}
+		}
+		hull.erase(hull.begin() + smallest);
+	}
+	out_hull = hull;
+}
+
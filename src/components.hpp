@@ -3,6 +3,8 @@
 #include <vector>
 #include <unordered_map>
 #include "../ext/stb_image/stb_image.h"
+#include "motion.hpp"
+#include "broadphase.hpp"
 #include <string>
 #include <array>
 
@@ -107,12 +109,21 @@ enum class GEOMETRY_BUFFER_ID {
 };
 const int geometry_count = (int)GEOMETRY_BUFFER_ID::GEOMETRY_COUNT;
 
+// Increases with every render request made, see RenderRequest::order
+inline unsigned int next_render_order()
+{
+	static unsigned int next = 0;
+	return next++;
+}
+
 struct RenderRequest {
 	TEXTURE_ASSET_ID used_texture = TEXTURE_ASSET_ID::TEXTURE_COUNT;
 	EFFECT_ASSET_ID used_effect = EFFECT_ASSET_ID::EFFECT_COUNT;
 	GEOMETRY_BUFFER_ID used_geometry = GEOMETRY_BUFFER_ID::GEOMETRY_COUNT;
 
 	int num_frames = 1;
+	// Overlapping requests in the same pass are drawn in the order they were made, later on top
+	unsigned int order = next_render_order();
 };
 
 // Player component
@@ -192,34 +203,57 @@ struct Sickman
 struct Solid_Platform {
 };
 
-// All data relevant to the shape and motion of entities
-struct Motion {
-	vec2 position = { 0, 0 };
-	float angle = 0;
-	vec2 velocity = { 0, 0 };
-	vec2 acceleration = { 0,0 };
-	vec2 scale = { 10, 10 };
-	//Every motion componet has motion state
-	enum class State {Idle, Jump, Crouch, Climb};
-	State current_state;
+// Bodies that never move, such as platforms and walls. They are not integrated and only collide with
+// moving bodies, through a tree PhysicsSystem builds when the set of static bodies changes.
+struct StaticBody {
+};
 
+// Bodies PhysicsSystem moves by their velocity and acceleration. Every other body is placed by game code.
+struct DynamicBody {
+	float still_ms = 0.f; // how long the body has been slower than SLEEP_SPEED
 };
-// Enabling gravity for objects
-struct Gravity {
+
+// Dynamic bodies that have been nearly still for a while. They keep their position, are not integrated
+// and the broadphase only queries them, like static bodies. Running into an awake body, being moved or
+// set in motion, or wake_up wakes them again.
+struct Sleeping {
 };
 
-// Stucture to store collision information
-struct Collision
+// Bodies game code moves by setting their position, such as the mouse pointer and buttons. They are
+// never integrated or put to sleep, but collide like dynamic bodies.
+struct KinematicBody {
+};
+
+// The layers bodies collide on. A body takes part in collision detection through a CollisionFilter
+// component, see collision_filter for which layers collide with each other.
+enum class COLLISION_LAYER {
+	WORLD = 0,
+	PLAYER = WORLD + 1,
+	ENEMY = PLAYER + 1,
+	ITEM = ENEMY + 1,
+	UI = ITEM + 1,
+	LAYER_COUNT = UI + 1
+};
+const int collision_layer_count = (int)COLLISION_LAYER::LAYER_COUNT;
+
+// The bit of 'layer' in CollisionFilter::category and mask
+inline uint32_t layer_bit(COLLISION_LAYER layer)
 {
-	// Note, the first object is stored in the ECS container.entities
-	Entity other; // the second object involved in the collision
-	Collision(Entity& other) { this->other = other; };
+	return 1u << (uint32_t)layer;
+}
+
+// The filter for a body on 'layer', colliding with the layers the default layer matrix gives it
+CollisionFilter collision_filter(COLLISION_LAYER layer);
+
+// Enabling gravity for objects
+struct Gravity {
 };
 
 // Data structure for toggling debug mode
 struct Debug {
 	bool in_debug_mode = 0;
 	bool in_freeze_mode = 0;
+	BROADPHASE broadphase = BROADPHASE::SWEEP_AND_PRUNE; // cycled with B, see PhysicsSystem::set_broadphase
 };
 extern Debug debugging;
 
@@ -229,12 +263,6 @@ struct ScreenState
 	float darken_screen_factor = -1;
 };
 
-// A struct to refer to debugging graphics in the ECS
-struct DebugComponent
-{
-    // Note, an empty struct has size 1
-};
-
 // A struct to refer to debugging graphics in the ECS
 struct Help
 {
@@ -279,10 +307,15 @@ struct TexturedVertex
 struct Mesh
 {
 	static bool loadFromOBJFile(std::string obj_path, std::vector<ColoredVertex>& out_vertices, std::vector<uint16_t>& out_vertex_indices, vec2& out_size);
+	// Convex hull of the vertices in the xy plane, counter-clockwise and reduced to at most
+	// max_collision_hull_points by dropping the points that add the least area
+	static void computeCollisionHull(const std::vector<ColoredVertex>& vertices, std::vector<vec2>& out_hull);
 	vec2 original_size = {1,1};
 	std::vector<ColoredVertex> vertices;
 	std::vector<uint16_t> vertex_indices;
+	std::vector<vec2> collision_hull; // in the same normalized coordinates as the vertices
 };
+const size_t max_collision_hull_points = 32;
 
 struct Background {
     int layer;
@@ -0,0 +1,72 @@
+#pragma once
+
+#include <array>
+#include <tuple>
+#include <utility>
+#include <vector>
+#include "contacts.hpp"
+#include "tiny_ecs_registry.hpp"
+
+// A collision response: 'Handler', a member function taking const std::vector<Contact>&, is called with
+// the contacts between an entity that has A and none of ExcludeA and one that has B and none of ExcludeB.
+// e.g. OnContact<Player, Item, &WorldSystem::on_player_item, exclude_t<DeathTimer>>
+template <typename A, typename B, auto Handler, typename ExcludeA = exclude_t<>, typename ExcludeB = exclude_t<>>
+struct OnContact;
+
+template <typename A, typename B, auto Handler, typename... ExcludedA, typename... ExcludedB>
+struct OnContact<A, B, Handler, exclude_t<ExcludedA...>, exclude_t<ExcludedB...>>
+{
+	static constexpr auto handler = Handler;
+
+	static constexpr Signature include_a = GameRegistry::mask<A>();
+	static constexpr Signature filter_a = include_a | GameRegistry::mask<ExcludedA...>();
+	static constexpr Signature include_b = GameRegistry::mask<B>();
+	static constexpr Signature filter_b = include_b | GameRegistry::mask<ExcludedB...>();
+
+	// Whether entities with these signatures, in this order, make a contact the handler is for
+	static bool matches(Signature a, Signature b)
+	{
+		return (a & filter_a) == include_a && (b & filter_b) == include_b;
+	}
+};
+
+// Calls the handlers of a fixed list of OnContact rules. The contacts are sorted into one batch per rule
+// by testing both entity signatures against the rules' masks, unrolled at compile time, so a handler
+// gets only contacts it is for and doesn't have to look up components to tell. A contact goes into the
+// batch of every rule it matches, turned around if the rule matches it the other way, so that 'first'
+// is always the A side. Handlers run in the order of the rules.
+template <typename... Rules>
+class ContactDispatch
+{
+	typedef std::tuple<Rules...> RuleList;
+	std::array<std::vector<Contact>, sizeof...(Rules)> batches; // kept between calls so sorting doesn't allocate
+
+	template <size_t... I>
+	void sort(const Contact& contact, Signature first, Signature second, std::index_sequence<I...>)
+	{
+		((std::tuple_element_t<I, RuleList>::matches(first, second) ? batches[I].push_back(contact) : (void)0), ...);
+	}
+
+	template <typename Owner, size_t... I>
+	void handle(Owner& owner, std::index_sequence<I...>)
+	{
+		((owner.*std::tuple_element_t<I, RuleList>::handler)(batches[I]), ...);
+	}
+
+public:
+	template <typename Owner>
+	void dispatch(Owner& owner, const std::vector<Contact>& contacts)
+	{
+		for (std::vector<Contact>& batch : batches)
+			batch.clear();
+		for (const Contact& contact : contacts)
+		{
+			Signature first = registry.signature(contact.first);
+			Signature second = registry.signature(contact.second);
+			Contact reversed = { contact.second, contact.first, -contact.normal, contact.depth };
+			sort(contact, first, second, std::index_sequence_for<Rules...>{});
+			sort(reversed, second, first, std::index_sequence_for<Rules...>{});
+		}
+		handle(owner, std::index_sequence_for<Rules...>{});
+	}
+};
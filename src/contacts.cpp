@@ -0,0 +1,27 @@
+// internal
+#include "contacts.hpp"
+
+void ContactCache::add(Entity a, Entity b, vec2 normal, float depth)
+{
+	if ((unsigned int)b < (unsigned int)a)
+	{
+		std::swap(a, b);
+		normal = -normal;
+	}
+	found.push_back({ a, b, normal, depth });
+}
+
+void ContactCache::clear()
+{
+	found.clear();
+	contacts.clear();
+	merged.clear();
+	began_contacts.clear();
+	ended_contacts.clear();
+}
+
+void remove_repeated_pairs(std::vector<Contact>& contacts)
+{
+	std::sort(contacts.begin(), contacts.end(), ContactCache::less);
+	contacts.erase(std::unique(contacts.begin(), contacts.end(), ContactCache::same), contacts.end());
+}
@@ -0,0 +1,102 @@
+#pragma once
+
+#include <algorithm>
+#include <vector>
+#include <glm/vec2.hpp>
+#include "tiny_ecs.hpp"
+
+using glm::vec2;
+
+// Two entities in contact. 'normal' is the axis their boxes overlap least along, pointing from 'first'
+// to 'second', and 'depth' how far they overlap along it.
+struct Contact
+{
+	Entity first;
+	Entity second;
+	vec2 normal = { 0.f, 0.f };
+	float depth = 0.f;
+};
+
+// The contacts of the last step, kept so that a contact is reported once when it begins and once when
+// it ends instead of on every step it lasts
+class ContactCache
+{
+public:
+	// Records a contact found this step, in either order, 'normal' points from 'a' to 'b'. Finding one
+	// twice is the same as once. In the cache 'first' is the entity with the smaller handle.
+	void add(Entity a, Entity b, vec2 normal, float depth);
+
+	// Replaces the contacts with the ones added since the last update. The ones that weren't there before
+	// have begun, the old ones that weren't found again have ended, unless 'persists(contact)' is true,
+	// e.g. because its bodies weren't tested this step.
+	template <typename Persists>
+	void update(Persists persists);
+
+	// The changes of the last update, in order of the handles
+	const std::vector<Contact>& began() const { return began_contacts; }
+	const std::vector<Contact>& ended() const { return ended_contacts; }
+	// Every contact as of the last update, sorted. A lasting contact has the normal and depth of the last
+	// step it was found on.
+	const std::vector<Contact>& current() const { return contacts; }
+
+	void clear();
+
+private:
+	std::vector<Contact> found; // added since the last update
+	std::vector<Contact> contacts;
+	std::vector<Contact> merged; // the next contacts while updating
+	std::vector<Contact> began_contacts;
+	std::vector<Contact> ended_contacts;
+
+	static bool less(const Contact& a, const Contact& b)
+	{
+		return (unsigned int)a.first != (unsigned int)b.first
+			? (unsigned int)a.first < (unsigned int)b.first
+			: (unsigned int)a.second < (unsigned int)b.second;
+	}
+	static bool same(const Contact& a, const Contact& b)
+	{
+		return a.first == b.first && a.second == b.second;
+	}
+
+	friend void remove_repeated_pairs(std::vector<Contact>& contacts);
+};
+
+// Sorts 'contacts' by their entities, in the order given, and keeps one contact of each pair
+void remove_repeated_pairs(std::vector<Contact>& contacts);
+
+template <typename Persists>
+void ContactCache::update(Persists persists)
+{
+	remove_repeated_pairs(found);
+
+	// Both lists are sorted, a single merge tells new, lasting and gone contacts apart and keeps the
+	// result sorted
+	began_contacts.clear();
+	ended_contacts.clear();
+	merged.clear();
+	size_t i = 0, j = 0;
+	while (i < found.size() || j < contacts.size())
+	{
+		if (j == contacts.size() || (i < found.size() && less(found[i], contacts[j])))
+		{
+			began_contacts.push_back(found[i]);
+			merged.push_back(found[i++]);
+		}
+		else if (i == found.size() || less(contacts[j], found[i]))
+		{
+			if (persists(contacts[j]))
+				merged.push_back(contacts[j]);
+			else
+				ended_contacts.push_back(contacts[j]);
+			j++;
+		}
+		else
+		{
+			merged.push_back(found[i++]);
+			j++;
+		}
+	}
+	contacts.swap(merged);
+	found.clear();
+}
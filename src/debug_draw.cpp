@@ -0,0 +1,46 @@
+// internal
+#include "debug_draw.hpp"
+
+// stlib
+#include <glm/geometric.hpp>
+
+DebugDraw debug_draw;
+
+// In front of everything the other shaders draw
+const float debug_depth = 0.5f;
+
+void DebugDraw::quad(vec2 a, vec2 b, vec2 c, vec2 d, vec3 color)
+{
+	// Corners in order around the quad, split along a-c
+	ColoredVertex corners[4] = {
+		{ vec3(a, debug_depth), color },
+		{ vec3(b, debug_depth), color },
+		{ vec3(c, debug_depth), color },
+		{ vec3(d, debug_depth), color },
+	};
+	triangle_vertices.insert(triangle_vertices.end(), { corners[0], corners[1], corners[2], corners[0], corners[2], corners[3] });
+}
+
+void DebugDraw::line(vec2 a, vec2 b, vec3 color, float width)
+{
+	vec2 along = b - a;
+	float length = glm::length(along);
+	if (length == 0.f)
+		return;
+	vec2 side = vec2(-along.y, along.x) * (width / 2.f / length);
+	quad(a - side, b - side, b + side, a + side, color);
+}
+
+void DebugDraw::box(const AABB& box, vec3 color, float width)
+{
+	line({ box.min.x, box.min.y }, { box.max.x, box.min.y }, color, width);
+	line({ box.min.x, box.max.y }, { box.max.x, box.max.y }, color, width);
+	line({ box.min.x, box.min.y }, { box.min.x, box.max.y }, color, width);
+	line({ box.max.x, box.min.y }, { box.max.x, box.max.y }, color, width);
+}
+
+void DebugDraw::point(vec2 position, vec3 color, float size)
+{
+	vec2 half = vec2(size / 2.f);
+	quad(position - half, { position.x + half.x, position.y - half.y }, position + half, { position.x - half.x, position.y + half.y }, color);
+}
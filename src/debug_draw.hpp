@@ -0,0 +1,32 @@
+#pragma once
+
+#include <vector>
+#include "common.hpp"
+#include "components.hpp"
+
+// The color debug shapes are drawn in unless another one is given
+const vec3 DEBUG_COLOR = { 0.1f, 0.8f, 0.1f };
+
+// Immediate mode debug drawing. Shapes are appended to one vertex buffer as triangles, in world
+// coordinates, and the render system draws the whole buffer with a single call. Nothing is kept
+// between calls besides the buffer, so drawing a shape doesn't create an entity. The shapes stay on
+// screen until clear(), which WorldSystem::step calls at the start of every step.
+class DebugDraw
+{
+public:
+	// A line from 'a' to 'b', 'width' pixels wide
+	void line(vec2 a, vec2 b, vec3 color = DEBUG_COLOR, float width = 5.f);
+	// The outline of 'box', its edges 'width' pixels wide and centered on the box's sides
+	void box(const AABB& box, vec3 color = DEBUG_COLOR, float width = 5.f);
+	// A square 'size' pixels wide around 'position'
+	void point(vec2 position, vec3 color = DEBUG_COLOR, float size = 5.f);
+
+	void clear() { triangle_vertices.clear(); }
+	// Three per triangle
+	const std::vector<ColoredVertex>& vertices() const { return triangle_vertices; }
+
+private:
+	std::vector<ColoredVertex> triangle_vertices; // cleared, not freed, so drawing doesn't allocate
+	void quad(vec2 a, vec2 b, vec2 c, vec2 d, vec3 color);
+};
+extern DebugDraw debug_draw;
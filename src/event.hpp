@@ -9,17 +9,22 @@
 class Event
 {
 public:
-	enum EventType {COLLISION};
+	// Two entities started or stopped touching, see PhysicsSystem. By the time a contact ends either
+	// entity may have been destroyed.
+	enum EventType {COLLISION_BEGIN, COLLISION_END};
 
 	EventType type;
 	Entity entity;
 	Entity entity_other;
+	vec2 normal = { 0.f, 0.f }; // points from entity to entity_other
+	float depth = 0.f; // how far they overlap along the normal
 
 	//Creating the Event
 	Event(EventType t) : type(t) {};
 
 	//collision
 	Event(EventType t, Entity e, Entity e_o): type(t), entity(e), entity_other(e_o) {}
+	Event(EventType t, Entity e, Entity e_o, vec2 n, float d): type(t), entity(e), entity_other(e_o), normal(n), depth(d) {}
 
 
 
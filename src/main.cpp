@@ -4,6 +4,7 @@
 
 // stlib
 #include <chrono>
+#include <cmath>
 
 // internal
 #include "ai_system.hpp"
@@ -39,10 +40,15 @@ int main()
 
 	// initialize the main systems
 	renderer.init(window_width_px, window_height_px, window);
-	world.init(&renderer, window_width_px, window_height_px);
+	world.init(&renderer, &physics, window_width_px, window_height_px);
 
-	// variable timestep loop
+	// fixed timestep loop
+	// The frame time is collected in an accumulator and the simulation advances in steps of
+	// FIXED_STEP_MS, so a long frame runs several short steps instead of one long one. The time
+	// left over in the accumulator decides how far drawing blends from the previous step to the
+	// current one.
 	auto t = Clock::now();
+	float accumulator_ms = 0.f;
 	while (!world.is_over()) {
 		// Processes system messages, if this wasn't present the window would become
 		// unresponsive
@@ -54,12 +60,32 @@ int main()
 		(float)(std::chrono::duration_cast<std::chrono::microseconds>(now - t)).count() / 1000;
 		t = now;
 
-		world.step(elapsed_ms);
-        renderer.updateBackgrounds(elapsed_ms, window_width_px, window_height_px);
-		physics.step(elapsed_ms, window_width_px, window_height_px);
-		world.handle_collisions();
+		accumulator_ms += elapsed_ms;
+		int steps = 0;
+		while (accumulator_ms >= FIXED_STEP_MS && steps < MAX_STEPS_PER_FRAME) {
+			registry.motions.components.save_previous_positions();
 
-		renderer.draw();
+			world.step(FIXED_STEP_MS);
+			renderer.updateBackgrounds(FIXED_STEP_MS, window_width_px, window_height_px);
+
+			// Fast bodies get substeps, each with its own collision pass. The collisions of all substeps
+			// are handled once the step is done, so the game reacts once per step and a level change
+			// doesn't happen in the middle of one.
+			int substeps = physics.substeps(FIXED_STEP_MS);
+			for (int i = 0; i < substeps; i++)
+				physics.step(FIXED_STEP_MS / substeps, window_width_px, window_height_px);
+			world.handle_collisions();
+			physics.draw_debug();
+
+			accumulator_ms -= FIXED_STEP_MS;
+			steps++;
+		}
+		// After a frame too long to catch up with, e.g. a blocking wait, the game slows down
+		// instead of running ever more steps per frame
+		if (accumulator_ms >= FIXED_STEP_MS)
+			accumulator_ms = std::fmod(accumulator_ms, FIXED_STEP_MS);
+
+		renderer.draw(accumulator_ms / FIXED_STEP_MS);
 
 		// TODO A2: you can implement the debug freeze here but other places are possible too.
 	}
@@ -0,0 +1,143 @@
+#pragma once
+
+#include <vector>
+#include <limits>
+#include <glm/vec2.hpp>
+#include "tiny_ecs.hpp"
+
+using glm::vec2;
+
+// All data relevant to the shape and motion of entities
+// ComponentContainer<Motion> doesn't store this struct, see MotionStreams
+struct Motion {
+	vec2 position = { 0, 0 };
+	float angle = 0;
+	vec2 velocity = { 0, 0 };
+	vec2 acceleration = { 0,0 };
+	vec2 scale = { 10, 10 };
+	//Every motion componet has motion state
+	enum class State {Idle, Jump, Crouch, Climb};
+	State current_state;
+	// Where the body was when the current fixed step started, drawing blends from there to position.
+	// NaN until a step started with the body in the world, such a body is drawn where it is.
+	vec2 previous_position = vec2(std::numeric_limits<float>::quiet_NaN());
+};
+
+// What registry.motions.get(e) returns: references to the fields of one motion in the streams.
+// Reads and writes like a Motion (motion.position.x += 1), converts to a Motion copy where one is
+// needed and can be assigned a Motion. Hold it by value (auto motion = ...), not by reference.
+struct MotionRef {
+	vec2& position;
+	float& angle;
+	vec2& velocity;
+	vec2& acceleration;
+	vec2& scale;
+	Motion::State& current_state;
+	vec2& previous_position;
+
+	operator Motion() const
+	{
+		Motion motion;
+		motion.position = position;
+		motion.angle = angle;
+		motion.velocity = velocity;
+		motion.acceleration = acceleration;
+		motion.scale = scale;
+		motion.current_state = current_state;
+		motion.previous_position = previous_position;
+		return motion;
+	}
+
+	MotionRef& operator=(const Motion& motion)
+	{
+		position = motion.position;
+		angle = motion.angle;
+		velocity = motion.velocity;
+		acceleration = motion.acceleration;
+		scale = motion.scale;
+		current_state = motion.current_state;
+		previous_position = motion.previous_position;
+		return *this;
+	}
+
+	// Copies the referenced values, not the references
+	MotionRef& operator=(const MotionRef& other)
+	{
+		return *this = Motion(other);
+	}
+};
+
+// Motions laid out as one array per field. Integration streams through positions, velocities and
+// accelerations, bounding boxes through positions and scales, and neither loads angles or states.
+// Provides the part of the std::vector interface that ComponentContainer uses.
+class MotionStreams
+{
+public:
+	std::vector<vec2> positions;
+	std::vector<vec2> velocities;
+	std::vector<vec2> accelerations;
+	std::vector<vec2> scales; // extents, negative to mirror the sprite
+	std::vector<float> angles;
+	std::vector<Motion::State> states;
+	std::vector<vec2> previous_positions; // positions at the start of the current fixed step
+
+	MotionRef operator[](size_t i)
+	{
+		return { positions[i], angles[i], velocities[i], accelerations[i], scales[i], states[i], previous_positions[i] };
+	}
+
+	// Called when a fixed step starts, before anything moves
+	void save_previous_positions()
+	{
+		previous_positions = positions;
+	}
+
+	MotionRef back()
+	{
+		return (*this)[size() - 1];
+	}
+
+	void push_back(const Motion& motion)
+	{
+		positions.push_back(motion.position);
+		velocities.push_back(motion.velocity);
+		accelerations.push_back(motion.acceleration);
+		scales.push_back(motion.scale);
+		angles.push_back(motion.angle);
+		states.push_back(motion.current_state);
+		previous_positions.push_back(motion.previous_position);
+	}
+
+	void pop_back()
+	{
+		positions.pop_back();
+		velocities.pop_back();
+		accelerations.pop_back();
+		scales.pop_back();
+		angles.pop_back();
+		states.pop_back();
+		previous_positions.pop_back();
+	}
+
+	void clear()
+	{
+		positions.clear();
+		velocities.clear();
+		accelerations.clear();
+		scales.clear();
+		angles.clear();
+		states.clear();
+		previous_positions.clear();
+	}
+
+	size_t size() const
+	{
+		return positions.size();
+	}
+};
+
+template <>
+struct ComponentStorage<Motion>
+{
+	typedef MotionStreams type;
+};
@@ -0,0 +1,264 @@
+// internal
+#include "narrowphase.hpp"
+
+// stlib
+#include <algorithm>
+#include <cmath>
+#include <glm/common.hpp>
+
+// The vector kernels need SSE2, part of every x86-64 target. 32-bit x86 builds only have it when the
+// compiler targets it, without it only the scalar kernel is built.
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define NARROWPHASE_SSE2 1
+#include <immintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+#endif
+
+// GCC and Clang only emit AVX instructions in functions that ask for them, MSVC always can
+#if defined(NARROWPHASE_SSE2) && (defined(__GNUC__) || defined(__clang__))
+#define TARGET_AVX2 __attribute__((target("avx2")))
+#else
+#define TARGET_AVX2
+#endif
+
+vec2 get_bounding_box(vec2 scale)
+{
+	// abs is to avoid negative scale due to the facing direction.
+	return { std::abs(scale.x), std::abs(scale.y) };
+}
+
+bool collides(vec2 position1, vec2 scale1, vec2 position2, vec2 scale2)
+{
+	// calc 2 opposite corners of each object using position as center pt and adding half of the scale
+	vec2 m1_bounding_box = get_bounding_box(scale1);
+	vec2 m2_bounding_box = get_bounding_box(scale2);
+
+	vec2 m1_top_left = position1 - m1_bounding_box / 2.f;
+	vec2 m1_bot_right = position1 + m1_bounding_box / 2.f;
+	vec2 m2_top_left = position2 - m2_bounding_box / 2.f;
+	vec2 m2_bot_right = position2 + m2_bounding_box / 2.f;
+
+	//check horizontal distance between them
+	if (m1_top_left.x > m2_bot_right.x || m2_top_left.x > m1_bot_right.x) {
+		return false;
+	}
+
+	//check vertical distance between them
+	if (m1_bot_right.y < m2_top_left.y || m2_bot_right.y < m1_top_left.y) {
+		return false;
+	}
+	return true;
+}
+
+AABB get_aabb(vec2 position, vec2 scale)
+{
+	vec2 half_extent = get_bounding_box(scale) / 2.f;
+	return { position - half_extent, position + half_extent };
+}
+
+float penetration(const AABB& a, const AABB& b, vec2& normal)
+{
+	vec2 overlap = glm::min(a.max, b.max) - glm::max(a.min, b.min);
+	vec2 centers = (b.min + b.max) - (a.min + a.max); // twice the distance between the centers
+	int axis = overlap.x < overlap.y ? 0 : 1;
+	normal = vec2(0.f);
+	normal[axis] = centers[axis] < 0.f ? -1.f : 1.f;
+	return overlap[axis];
+}
+
+bool sweep_aabb(const AABB& box, vec2 displacement, const AABB& obstacle, float& time, vec2& normal)
+{
+	// Per axis, the times the moving box's leading edge reaches the obstacle and its trailing edge leaves it
+	float entry[2], exit[2];
+	for (int axis = 0; axis < 2; axis++)
+	{
+		float d = displacement[axis];
+		if (d > 0.f)
+		{
+			entry[axis] = (obstacle.min[axis] - box.max[axis]) / d;
+			exit[axis] = (obstacle.max[axis] - box.min[axis]) / d;
+		}
+		else if (d < 0.f)
+		{
+			entry[axis] = (obstacle.max[axis] - box.min[axis]) / d;
+			exit[axis] = (obstacle.min[axis] - box.max[axis]) / d;
+		}
+		// Not moving along this axis, boxes that only touch here don't meet: a body resting on a row of
+		// platforms slides over the seams instead of catching on the next platform's side
+		else if (box.max[axis] <= obstacle.min[axis] || obstacle.max[axis] <= box.min[axis])
+			return false;
+		else
+		{
+			entry[axis] = -INFINITY;
+			exit[axis] = INFINITY;
+		}
+	}
+
+	float first_entry = std::max(entry[0], entry[1]);
+	float last_exit = std::min(exit[0], exit[1]);
+	if (first_entry >= last_exit || first_entry < 0.f || first_entry > 1.f)
+		return false;
+
+	// The axis entered last is the one the boxes meet along
+	int axis = entry[0] > entry[1] ? 0 : 1;
+	normal = vec2(0.f);
+	normal[axis] = displacement[axis] > 0.f ? -1.f : 1.f;
+	time = first_entry;
+	return true;
+}
+
+const char* simd_level_name(SIMD_LEVEL level)
+{
+	switch (level)
+	{
+	case SIMD_LEVEL::SCALAR:
+		return "scalar";
+	case SIMD_LEVEL::SSE2:
+		return "sse2";
+	case SIMD_LEVEL::AVX2:
+		return "avx2";
+	default:
+		return "unknown";
+	}
+}
+
+// All kernels reject a box the way collides() does, so a comparison with NaN doesn't reject
+
+static size_t overlap_batch_scalar(const AABB& box, const AABBStreams& boxes, size_t begin, size_t end, unsigned int* out)
+{
+	size_t count = 0;
+	for (size_t i = begin; i < end; i++)
+	{
+		bool separated = box.min.x > boxes.max_x[i] || boxes.min_x[i] > box.max.x
+			|| box.max.y < boxes.min_y[i] || boxes.max_y[i] < box.min.y;
+		// Written unconditionally and kept only on overlap, there is no branch to mispredict
+		out[count] = (unsigned int)i;
+		count += !separated;
+	}
+	return count;
+}
+
+#ifdef NARROWPHASE_SSE2
+
+// Appends the indices of the zero bits of the lowest 'lanes' bits of 'separated', starting at 'first'
+static size_t append_overlaps(unsigned int separated, unsigned int lanes, size_t first, unsigned int* out)
+{
+	size_t count = 0;
+	for (unsigned int lane = 0; lane < lanes; lane++)
+	{
+		out[count] = (unsigned int)(first + lane);
+		count += ((separated >> lane) & 1) ^ 1;
+	}
+	return count;
+}
+
+static size_t overlap_batch_sse2(const AABB& box, const AABBStreams& boxes, size_t begin, size_t end, unsigned int* out)
+{
+	const __m128 box_min_x = _mm_set1_ps(box.min.x);
+	const __m128 box_min_y = _mm_set1_ps(box.min.y);
+	const __m128 box_max_x = _mm_set1_ps(box.max.x);
+	const __m128 box_max_y = _mm_set1_ps(box.max.y);
+
+	size_t count = 0;
+	size_t i = begin;
+	for (; i + 4 <= end; i += 4)
+	{
+		__m128 separated = _mm_or_ps(
+			_mm_or_ps(_mm_cmpgt_ps(box_min_x, _mm_loadu_ps(&boxes.max_x[i])), _mm_cmpgt_ps(_mm_loadu_ps(&boxes.min_x[i]), box_max_x)),
+			_mm_or_ps(_mm_cmplt_ps(box_max_y, _mm_loadu_ps(&boxes.min_y[i])), _mm_cmplt_ps(_mm_loadu_ps(&boxes.max_y[i]), box_min_y)));
+		unsigned int mask = (unsigned int)_mm_movemask_ps(separated);
+		// Most candidates are far away, a block of four separated ones is skipped in one go
+		if (mask != 0xf)
+			count += append_overlaps(mask, 4, i, out + count);
+	}
+	return count + overlap_batch_scalar(box, boxes, i, end, out + count);
+}
+
+TARGET_AVX2
+static size_t overlap_batch_avx2(const AABB& box, const AABBStreams& boxes, size_t begin, size_t end, unsigned int* out)
+{
+	const __m256 box_min_x = _mm256_set1_ps(box.min.x);
+	const __m256 box_min_y = _mm256_set1_ps(box.min.y);
+	const __m256 box_max_x = _mm256_set1_ps(box.max.x);
+	const __m256 box_max_y = _mm256_set1_ps(box.max.y);
+
+	size_t count = 0;
+	size_t i = begin;
+	for (; i + 8 <= end; i += 8)
+	{
+		// Ordered, non-signalling comparisons: false for NaN, like the scalar ones
+		__m256 separated = _mm256_or_ps(
+			_mm256_or_ps(_mm256_cmp_ps(box_min_x, _mm256_loadu_ps(&boxes.max_x[i]), _CMP_GT_OQ), _mm256_cmp_ps(_mm256_loadu_ps(&boxes.min_x[i]), box_max_x, _CMP_GT_OQ)),
+			_mm256_or_ps(_mm256_cmp_ps(box_max_y, _mm256_loadu_ps(&boxes.min_y[i]), _CMP_LT_OQ), _mm256_cmp_ps(_mm256_loadu_ps(&boxes.max_y[i]), box_min_y, _CMP_LT_OQ)));
+		unsigned int mask = (unsigned int)_mm256_movemask_ps(separated);
+		if (mask != 0xff)
+			count += append_overlaps(mask, 8, i, out + count);
+	}
+	// The SSE2 code for the rest isn't VEX encoded, with the upper halves of the registers still in
+	// use every one of its instructions would pay for the transition. Runs are often shorter than 8.
+	_mm256_zeroupper();
+	return count + overlap_batch_sse2(box, boxes, i, end, out + count);
+}
+
+static bool cpu_has_avx2()
+{
+#if defined(__GNUC__) || defined(__clang__)
+	__builtin_cpu_init();
+	return __builtin_cpu_supports("avx2");
+#elif defined(_MSC_VER)
+	int info[4];
+	__cpuid(info, 0);
+	if (info[0] < 7)
+		return false;
+	__cpuid(info, 1);
+	bool osxsave = (info[2] & (1 << 27)) != 0;
+	bool avx = (info[2] & (1 << 28)) != 0;
+	// The OS has to save the ymm registers on a context switch
+	if (!osxsave || !avx || (_xgetbv(0) & 0x6) != 0x6)
+		return false;
+	__cpuidex(info, 7, 0);
+	return (info[1] & (1 << 5)) != 0;
+#else
+	return false;
+#endif
+}
+
+#endif
+
+SIMD_LEVEL best_simd_level()
+{
+#ifdef NARROWPHASE_SSE2
+	// Every CPU a build with SSE2 runs on has it
+	static const SIMD_LEVEL level = cpu_has_avx2() ? SIMD_LEVEL::AVX2 : SIMD_LEVEL::SSE2;
+	return level;
+#else
+	return SIMD_LEVEL::SCALAR;
+#endif
+}
+
+OverlapBatch overlap_batch_kernel(SIMD_LEVEL level)
+{
+	if ((int)level > (int)best_simd_level())
+		return nullptr;
+	switch (level)
+	{
+	case SIMD_LEVEL::SCALAR:
+		return overlap_batch_scalar;
+#ifdef NARROWPHASE_SSE2
+	case SIMD_LEVEL::SSE2:
+		return overlap_batch_sse2;
+	case SIMD_LEVEL::AVX2:
+		return overlap_batch_avx2;
+#endif
+	default:
+		return nullptr;
+	}
+}
+
+size_t overlap_batch(const AABB& box, const AABBStreams& boxes, size_t begin, size_t end, unsigned int* out)
+{
+	static const OverlapBatch kernel = overlap_batch_kernel(best_simd_level());
+	return kernel(box, boxes, begin, end, out);
+}
@@ -0,0 +1,46 @@
+#pragma once
+
+#include <vector>
+#include <cstddef>
+#include <glm/vec2.hpp>
+#include "broadphase.hpp"
+
+using glm::vec2;
+
+// Returns the local bounding coordinates scaled by the current size of the entity
+vec2 get_bounding_box(vec2 scale);
+// Whether the boxes around two bodies overlap, touching counts
+bool collides(vec2 position1, vec2 scale1, vec2 position2, vec2 scale2);
+// The box collides() tests for a body, the same comparisons on it give the same answer
+AABB get_aabb(vec2 position, vec2 scale);
+
+// How far two overlapping boxes overlap along the axis they overlap least, and the normal of that axis
+// pointing from 'a' to 'b'
+float penetration(const AABB& a, const AABB& b, vec2& normal);
+
+// When 'box', moved by 'displacement', first touches the still 'obstacle', as a fraction of the move in
+// [0, 1], and the normal of the obstacle's face it runs into. False if it misses, only grazes a corner
+// or already overlaps the obstacle where it starts.
+bool sweep_aabb(const AABB& box, vec2 displacement, const AABB& obstacle, float& time, vec2& normal);
+
+// Instruction sets the batch kernels are written for, from slowest to fastest
+enum class SIMD_LEVEL {
+	SCALAR = 0,
+	SSE2 = SCALAR + 1, // 4 boxes per instruction
+	AVX2 = SSE2 + 1, // 8 boxes per instruction
+	SIMD_LEVEL_COUNT = AVX2 + 1
+};
+
+const char* simd_level_name(SIMD_LEVEL level);
+// The fastest level this CPU supports, detected once
+SIMD_LEVEL best_simd_level();
+
+// Tests 'box' against boxes[begin, end) and writes the indices of those that overlap it to 'out', in
+// increasing order, returns how many. 'out' needs room for end - begin indices. Gives the same
+// answers as collides(), touching boxes and NaN extents count as overlapping.
+typedef size_t (*OverlapBatch)(const AABB& box, const AABBStreams& boxes, size_t begin, size_t end, unsigned int* out);
+
+// The kernel for 'level', nullptr if this build or CPU can't run it
+OverlapBatch overlap_batch_kernel(SIMD_LEVEL level);
+// Runs the kernel for best_simd_level()
+size_t overlap_batch(const AABB& box, const AABBStreams& boxes, size_t begin, size_t end, unsigned int* out);
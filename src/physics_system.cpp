@@ -2,78 +2,317 @@
 #include "physics_system.hpp"
 #include "world_init.hpp"
 #include "common.hpp"
+#include "debug_draw.hpp"
 
 const float pi = std::atan(1) * 4;
 
+// Bodies per integration chunk, one bit each in the chunk masks
+const size_t integration_chunk = 64;
+
 // unsigned int level_state;
 
-// Returns the local bounding coordinates scaled by the current size of the entity
 vec2 get_bounding_box(const Motion& motion)
 {
-	// abs is to avoid negative scale due to the facing direction.
-	return { abs(motion.scale.x), abs(motion.scale.y) };
+	return get_bounding_box(motion.scale);
 }
 
-// This is a SUPER APPROXIMATE check that puts a circle around the bounding boxes and sees
-// if the center point of either object is inside the other's bounding-box-circle. You can
-// surely implement a more accurate detection
 bool collides(const Motion& motion1, const Motion& motion2)
 {
-	// calc 2 opposite corners of each object using position as center pt and adding half of the scale
-	vec2 m1_bounding_box = get_bounding_box(motion1);
-	vec2 m2_bounding_box = get_bounding_box(motion2);
+	return collides(motion1.position, motion1.scale, motion2.position, motion2.scale);
+}
 
-	vec2 m1_top_left = motion1.position - m1_bounding_box / 2.f;
-	vec2 m1_bot_right = motion1.position + m1_bounding_box / 2.f;
-	vec2 m2_top_left = motion2.position - m2_bounding_box / 2.f;
-	vec2 m2_bot_right = motion2.position + m2_bounding_box / 2.f;
+void wake_up(Entity entity)
+{
+	registry.sleepingBodies.remove(entity);
+	if (DynamicBody* body = registry.dynamicBodies.find(entity))
+		body->still_ms = 0.f;
+}
 
-	//check horizontal distance between them
-	if (m1_top_left.x > m2_bot_right.x || m2_top_left.x > m1_bot_right.x) {
+bool PhysicsSystem::StillBodies::update(const std::vector<Entity>& bodies)
+{
+	if (bodies == entities)
 		return false;
-	}
+	entities = bodies;
 
-	//check vertical distance between them
-	if (m1_bot_right.y < m2_top_left.y || m2_bot_right.y < m1_top_left.y) {
-		return false;
+	colliders.clear();
+	boxes.clear();
+	filters.clear();
+	for (Entity entity : entities)
+	{
+		if (!registry.motions.has(entity) || !registry.collisionFilters.has(entity))
+			continue;
+		const CollisionFilter& filter = registry.collisionFilters.get(entity);
+		MotionRef motion = registry.motions.get(entity);
+		colliders.push_back(entity);
+		boxes.push_back(get_aabb(motion.position, motion.scale));
+		filters.push_back(filter);
 	}
+	tree.build(boxes);
 	return true;
 }
 
-void PhysicsSystem::step(float elapsed_ms, float window_width_px, float window_height_px)
+void PhysicsSystem::StillBodies::find_moved(std::vector<Entity>& moved) const
 {
-	// Move entities based on how much time has passed, this is to (partially) avoid
-	// having entities move at different speed based on the machine.
-    float step_seconds = 1.0f * (elapsed_ms / 1000.f);
-	if (level_state == LEVEL_STATE_SELECTOR) {
-		auto& motion_registry = registry.motions;
-		for (uint i = 0; i < motion_registry.size(); i++)
-		{
-			// !!! TODO PHYSICS: update motion.position based on step_seconds and motion.velocity
-			Motion& motion = motion_registry.components[i];
-			Entity entity = motion_registry.entities[i];
+	for (size_t i = 0; i < colliders.size(); i++)
+	{
+		// A body that lost its Motion changes the set, the next update rebuilds anyway
+		if (!registry.motions.has(colliders[i]))
+			continue;
+		MotionRef motion = registry.motions.get(colliders[i]);
+		AABB box = get_aabb(motion.position, motion.scale);
+		if (box.min != boxes[i].min || box.max != boxes[i].max)
+			moved.push_back(colliders[i]);
+	}
+}
+
+void PhysicsSystem::update_static_tree()
+{
+	// Static bodies come and go with the level, so the tree is only rebuilt when their set changed
+	if (!statics.update(registry.staticBodies.entities))
+		return;
+
+	rotated_platforms = false;
+	for (Entity entity : statics.colliders)
+		if (registry.solid_platforms.has(entity) && registry.motions.get(entity).angle != 0.f)
+			rotated_platforms = true;
+}
 
+void PhysicsSystem::update_query_tree()
+{
+	update_static_tree();
+	const std::vector<Entity>& filtered = registry.collisionFilters.entities;
+	if (!queried.stale && filtered == queried.filtered)
+		return;
+	queried.stale = false;
+	queried.filtered = filtered;
+
+	queried.entities.clear();
+	queried.boxes.clear();
+	queried.categories.clear();
+	for (uint k = 0; k < filtered.size(); k++)
+	{
+		Entity entity = filtered[k];
+		if (registry.staticBodies.has(entity) || !registry.motions.has(entity))
+			continue;
+		MotionRef motion = registry.motions.get(entity);
+		queried.entities.push_back(entity);
+		queried.boxes.push_back(get_aabb(motion.position, motion.scale));
+		queried.categories.push_back(registry.collisionFilters.components[k].category);
+	}
+	queried.tree.build(queried.boxes);
+}
 
-			//Including gravity
-			if (registry.gravities.has(entity)) {
-				motion.velocity += step_seconds * vec2(0.f, GRAVITY_ACCEL);
+void PhysicsSystem::queryPoint(vec2 point, uint32_t mask, std::vector<Entity>& hits)
+{
+	queryAABB({ point, point }, mask, hits);
+}
+
+void PhysicsSystem::queryAABB(const AABB& box, uint32_t mask, std::vector<Entity>& hits)
+{
+	hits.clear();
+	update_query_tree();
+	statics.tree.query(box, [&](unsigned int s) {
+		if (statics.filters[s].category & mask)
+			hits.push_back(statics.colliders[s]);
+	});
+	queried.tree.query(box, [&](unsigned int q) {
+		if (queried.categories[q] & mask)
+			hits.push_back(queried.entities[q]);
+	});
+}
+
+bool PhysicsSystem::raycast(vec2 origin, vec2 direction, uint32_t mask, RaycastHit& hit)
+{
+	update_query_tree();
+	// Each tree stops looking past the nearest hit so far
+	hit.time = 1.f;
+	bool found = false;
+	statics.tree.raycast(origin, direction, [&](unsigned int s, float time) {
+		if (!(statics.filters[s].category & mask) || time > hit.time)
+			return hit.time;
+		hit.entity = statics.colliders[s];
+		hit.time = time;
+		found = true;
+		return time;
+	});
+	queried.tree.raycast(origin, direction, [&](unsigned int q, float time) {
+		if (!(queried.categories[q] & mask) || time > hit.time)
+			return hit.time;
+		hit.entity = queried.entities[q];
+		hit.time = time;
+		found = true;
+		return time;
+	});
+	if (found)
+		hit.point = origin + hit.time * direction;
+	return found;
+}
+
+int PhysicsSystem::substeps(float step_ms) const
+{
+	float step_seconds = step_ms / 1000.f;
+	float largest = 0.f; // largest distance moved relative to half the body's size
+	registry.view<DynamicBody, Motion>(exclude<Sleeping>).each([&](Entity entity, DynamicBody&, MotionRef motion) {
+		if (!registry.collisionFilters.has(entity))
+			return;
+		vec2 travel = abs(motion.velocity) * step_seconds;
+		vec2 half_extent = max(get_bounding_box(motion) / 2.f, vec2(1.f));
+		largest = max(largest, max(travel.x / half_extent.x, travel.y / half_extent.y));
+	});
+	int count = (int)ceil(min(largest, (float)max_substeps));
+	return count > 1 ? count : 1;
+}
+
+void PhysicsSystem::move_swept(vec2& position, vec2 scale, vec2& velocity, vec2 displacement) const
+{
+	// Each hit takes away one axis of the move, so after two nothing is left
+	for (int iteration = 0; iteration < 2 && displacement != vec2(0.f); iteration++)
+	{
+		AABB box = get_aabb(position, scale);
+		AABB swept = { min(box.min, box.min + displacement), max(box.max, box.max + displacement) };
+
+		float first_time = 1.f;
+		vec2 first_normal = vec2(0.f);
+		statics.tree.query(swept, [&](unsigned int s) {
+			float time;
+			vec2 normal;
+			if (registry.solid_platforms.has(statics.colliders[s])
+				&& sweep_aabb(box, displacement, statics.boxes[s], time, normal) && time < first_time)
+			{
+				first_time = time;
+				first_normal = normal;
 			}
-			motion.velocity += step_seconds * motion.acceleration;
-			motion.position += step_seconds * motion.velocity;
-		}
+		});
+
+		// Up to the first platform in the way, touching it, which still counts as a collision
+		position += displacement * first_time;
+		if (first_normal == vec2(0.f))
+			break;
+
+		// Stop moving into the platform and slide along it for the rest of the step
+		int axis = first_normal.x != 0.f ? 0 : 1;
+		velocity[axis] = 0.f;
+		displacement[axis] = 0.f;
+		displacement *= 1.f - first_time;
 	}
-	else if (level_state == LEVEL_STATE_COMBAT) {
-		auto& motion_registry = registry.motions;
-		for (uint i = 0; i < motion_registry.size(); i++)
-		{
-			// !!! TODO PHYSICS: update motion.position based on step_seconds and motion.velocity
-			Motion& motion = motion_registry.components[i];
-			Entity entity = motion_registry.entities[i];
+}
+
+void PhysicsSystem::integrate_chunk(size_t chunk, float step_seconds, float elapsed_ms)
+{
+	IntegrationStreams& bodies = integration;
+	size_t begin = chunk * integration_chunk;
+	size_t end = std::min(begin + integration_chunk, bodies.positions.size());
+	uint64_t gravity = bodies.gravity_masks[chunk];
+
+	// Velocities first, in a branch-free loop over the streams
+	vec2 gravity_step = step_seconds * vec2(0.f, GRAVITY_ACCEL);
+	for (size_t i = begin; i < end; i++)
+	{
+		float has_gravity = (float)((gravity >> (i - begin)) & 1);
+		bodies.velocities[i] += has_gravity * gravity_step;
+		bodies.velocities[i] += step_seconds * bodies.accelerations[i];
+	}
+
+	// Falling bodies are fast enough to pass through a platform within one step, they are swept
+	// against the platforms instead of moved
+	uint64_t asleep = 0;
+	for (size_t i = begin; i < end; i++)
+	{
+		unsigned int bit = (unsigned int)(i - begin);
+		vec2 displacement = step_seconds * bodies.velocities[i];
+		if ((gravity >> bit) & 1)
+			move_swept(bodies.positions[i], bodies.scales[i], bodies.velocities[i], displacement);
+		else
+			bodies.positions[i] += displacement;
+
+		// A body that is still accelerating isn't at rest, however slow it is
+		if (length(bodies.velocities[i]) < SLEEP_SPEED && bodies.accelerations[i] == vec2(0.f))
+			bodies.still_ms[i] += elapsed_ms;
+		else
+			bodies.still_ms[i] = 0.f;
+		if (bodies.still_ms[i] >= SLEEP_DELAY_MS)
+			asleep |= uint64_t(1) << bit;
+	}
+	bodies.sleep_masks[chunk] = asleep;
+}
 
-			motion.position = motion.position;
+void PhysicsSystem::step(float elapsed_ms, float /*window_width_px*/, float window_height_px)
+{
+	// Move entities based on how much time has passed, this is to (partially) avoid
+	// having entities move at different speed based on the machine.
+    float step_seconds = 1.0f * (elapsed_ms / 1000.f);
+	// A sleeping body is at rest where it fell asleep. One that was moved or set in motion without
+	// waking it up is woken now, before it would be left out of the integration and the sleeper tree
+	// kept its old box.
+	waking.clear();
+	for (Entity entity : registry.sleepingBodies.entities)
+	{
+		if (!registry.motions.has(entity))
+			continue;
+		MotionRef motion = registry.motions.get(entity);
+		if (motion.velocity != vec2(0.f) || motion.acceleration != vec2(0.f))
+			waking.push_back(entity);
+	}
+	sleepers.find_moved(waking);
+	for (Entity entity : waking)
+		if (registry.sleepingBodies.has(entity))
+			wake_up(entity);
 
+	if (level_state == LEVEL_STATE_SELECTOR) {
+		// Only dynamic bodies that are awake move, the cost follows them rather than every Motion. They
+		// are gathered into contiguous streams, integrated chunk by chunk and written back. A body only
+		// depends on itself and the static tree, so the result is the same on any number of threads.
+		update_static_tree();
+		IntegrationStreams& bodies = integration;
+		bodies.entities.clear();
+		bodies.motion_indices.clear();
+		bodies.positions.clear();
+		bodies.velocities.clear();
+		bodies.accelerations.clear();
+		bodies.scales.clear();
+		bodies.still_ms.clear();
+		bodies.gravity_masks.clear();
+		bodies.sleep_masks.clear();
+		registry.view<DynamicBody, Motion>(exclude<Sleeping>).each([&](Entity entity, DynamicBody& body, MotionRef motion) {
+			size_t i = bodies.entities.size();
+			if (i % integration_chunk == 0)
+			{
+				bodies.gravity_masks.push_back(0);
+				bodies.sleep_masks.push_back(0);
+			}
+			if (registry.gravities.has(entity))
+				bodies.gravity_masks.back() |= uint64_t(1) << (i % integration_chunk);
+			bodies.entities.push_back(entity);
+			bodies.motion_indices.push_back(registry.motions.index_of(entity));
+			bodies.positions.push_back(motion.position);
+			bodies.velocities.push_back(motion.velocity);
+			bodies.accelerations.push_back(motion.acceleration);
+			bodies.scales.push_back(motion.scale);
+			bodies.still_ms.push_back(body.still_ms);
+		});
+
+		size_t chunks = bodies.gravity_masks.size();
+		if (bodies.entities.size() >= PARALLEL_INTEGRATION_BODIES)
+			workers.parallel_for(chunks, [&](size_t chunk) { integrate_chunk(chunk, step_seconds, elapsed_ms); });
+		else
+			for (size_t chunk = 0; chunk < chunks; chunk++)
+				integrate_chunk(chunk, step_seconds, elapsed_ms);
+
+		MotionStreams& motions = registry.motions.components;
+		for (size_t i = 0; i < bodies.entities.size(); i++)
+		{
+			uint m = bodies.motion_indices[i];
+			motions.positions[m] = bodies.positions[i];
+			motions.velocities[m] = bodies.velocities[i];
+			registry.dynamicBodies.get(bodies.entities[i]).still_ms = bodies.still_ms[i];
+			if ((bodies.sleep_masks[i / integration_chunk] >> (i % integration_chunk)) & 1)
+			{
+				motions.velocities[m] = vec2(0.f);
+				registry.sleepingBodies.emplace(bodies.entities[i]);
+			}
 		}
 	}
+	// Nothing moves on its own in combat
 
     /*for (Entity emitter_entity : registry.emitters.entities) {
         auto& particle_motions = registry.particleMotions.get(emitter_entity);
@@ -94,66 +333,157 @@ void PhysicsSystem::step(float elapsed_ms, float window_width_px, float window_h
 
 
 	// Check for collisions between all moving entities
+	// Only bodies with a CollisionFilter that collides with some layer take part. The broadphase reports
+	// every pair of moving boxes that may overlap and whose filters accept each other once, the exact
+	// test then only runs on those candidates. Static and sleeping bodies are not in there, each moving
+	// box queries their trees instead.
+	if (debugging.broadphase != broadphase_kind)
+		set_broadphase(debugging.broadphase);
     ComponentContainer<Motion> &motion_container = registry.motions;
-	for(uint i = 0; i<motion_container.components.size(); i++)
+	const MotionStreams& streams = motion_container.components;
+	collider_boxes.clear();
+	collider_indices.clear();
+	collider_filters.clear();
+	collider_ids.clear();
+	ComponentContainer<CollisionFilter>& filters = registry.collisionFilters;
+	for (uint k = 0; k < filters.entities.size(); k++)
 	{
-		Motion& motion_i = motion_container.components[i];
-		Entity entity_i = motion_container.entities[i];
-		for(uint j = 0; j<motion_container.components.size(); j++) // i+1
-		{
-			if (i == j)
-				continue;
-
-			Motion& motion_j = motion_container.components[j];
-			Entity entity_j = motion_container.entities[j];
-
-			if (collides(motion_i, motion_j) && !(registry.mouses.has(entity_j) || registry.mouses.has(entity_i)))
-			{
+		Entity entity = filters.entities[k];
+		const CollisionFilter& filter = filters.components[k];
+		if (filter.mask == 0 || !motion_container.has(entity)
+			|| registry.staticBodies.has(entity) || registry.sleepingBodies.has(entity))
+			continue;
+		uint i = motion_container.index_of(entity);
+		collider_boxes.push_back(get_aabb(streams.positions[i], streams.scales[i]));
+		collider_indices.push_back(i);
+		collider_filters.push_back(filter);
+		collider_ids.push_back(entity.index());
+	}
+	broadphase->find_pairs(collider_boxes, collider_filters, collider_ids, candidate_pairs);
 
-				//Notify both of the entities of the collision
+	// The bounding box test reads the position and scale streams only
+	for (const BodyPair& pair : candidate_pairs)
+	{
+		uint i = collider_indices[pair.first];
+		uint j = collider_indices[pair.second];
+		if (collides(streams.positions[i], streams.scales[i], streams.positions[j], streams.scales[j]))
+		{
+			vec2 normal;
+			float depth = penetration(collider_boxes[pair.first], collider_boxes[pair.second], normal);
+			contacts.add(motion_container.entities[i], motion_container.entities[j], normal, depth);
+		}
+	}
 
-				registry.collisions.emplace_with_duplicates(entity_i, entity_j);
-				registry.collisions.emplace_with_duplicates(entity_j, entity_i);
+	// The tree holds exact boxes, so whatever overlaps collides
+	update_static_tree();
+	for (uint k = 0; k < collider_boxes.size(); k++)
+	{
+		Entity entity = motion_container.entities[collider_indices[k]];
+		const CollisionFilter& filter = collider_filters[k];
+		statics.tree.query(collider_boxes[k], [&](unsigned int s) {
+			if (!should_collide(filter, statics.filters[s]))
+				return;
+			vec2 normal;
+			float depth = penetration(collider_boxes[k], statics.boxes[s], normal);
+			contacts.add(entity, statics.colliders[s], normal, depth);
+		});
+	}
 
-			}
-		}
+	// Sleeping bodies haven't moved since they fell asleep, the same goes for them. A body that is
+	// run into wakes up, two sleeping bodies don't meet.
+	sleepers.update(registry.sleepingBodies.entities);
+	waking.clear();
+	for (uint k = 0; k < collider_boxes.size(); k++)
+	{
+		Entity entity = motion_container.entities[collider_indices[k]];
+		const CollisionFilter& filter = collider_filters[k];
+		sleepers.tree.query(collider_boxes[k], [&](unsigned int s) {
+			if (!should_collide(filter, sleepers.filters[s]))
+				return;
+			vec2 normal;
+			float depth = penetration(collider_boxes[k], sleepers.boxes[s], normal);
+			contacts.add(entity, sleepers.colliders[s], normal, depth);
+			waking.push_back(sleepers.colliders[s]);
+		});
 	}
-	//TODO Wall Collisions
 
-	// you may need the following quantities to compute wall positions
-	(float)window_width_px; (float)window_height_px;
+	// Observers hear about a contact when it begins and when it ends, not on the steps in between.
+	// Bodies that don't move, sleeping or static, weren't tested against each other, so their
+	// contacts last. This has to be decided before the bodies that were run into wake up.
+	contacts.update([](const Contact& contact) {
+		auto still = [](Entity entity) {
+			return registry.sleepingBodies.has(entity) || registry.staticBodies.has(entity);
+		};
+		return still(contact.first) && still(contact.second);
+	});
+	for (Entity entity : waking)
+		wake_up(entity);
+	for (const Contact& contact : contacts.began())
+		notify(Event(Event::COLLISION_BEGIN, contact.first, contact.second, contact.normal, contact.depth));
+	for (const Contact& contact : contacts.ended())
+		notify(Event(Event::COLLISION_END, contact.first, contact.second, contact.normal, contact.depth));
+	// Bodies have moved, the next query rebuilds its tree
+	queried.stale = true;
+	//TODO Wall Collisions
 
 	/***************************************************************************************
 	TEMP COLLISION CODE FOR TESTING MOVEMENT BELOW
 	****************************************************************************************/
     ComponentContainer<Player> &player_container = registry.players;
     Entity player = player_container.entities[0];
-    Motion& player_motion = registry.motions.get(player);
+    MotionRef player_motion = registry.motions.get(player);
 
     Transform transform;
     transform.translate(vec3(player_motion.position.x, player_motion.position.y, 1.0));
     transform.rotate(player_motion.angle);
     transform.scale(player_motion.scale);
 
+    // The hull is transformed once, a point in the world is its offset plus the player's current position
     auto& meshes = registry.meshPtrs.get(player);
-    uint player_vertices = meshes->vertices.size();
-    vec2 bounding_box = get_bounding_box(player_motion);
+    hull_offsets.clear();
+    for (vec2 point : meshes->collision_hull) {
+        vec3 worldPosition = transform.mat * vec3(point, 0.f);
+        hull_offsets.push_back({worldPosition.x, worldPosition.y});
+    }
+
+
 
+    // Keeping the player inside the level doesn't depend on the platform, so it runs once per point
+    if (rotated_platforms) {
+        for (vec2 offset : hull_offsets) {
+            vec2 worldPos2D = player_motion.position + offset;
+            if (worldPos2D.x < 0) {
+                player_motion.position.x = -player_motion.scale.x / 2;
+            } else if (player_motion.position.y > window_height_px + player_motion.scale.y/2) {
+                player_motion.velocity.y = 0;
+                player_motion.position.y = window_height_px + player_motion.scale.y/2;
+            }
+        }
+    }
 
-    auto& collisionsRegistry = registry.collisions;
-    for (Entity entity : registry.solid_platforms.entities) {
-        Motion& solid_motion = registry.motions.get(entity);
+    // Only platforms the hull's box overlaps can contain one of its points
+    AABB hull_box = { player_motion.position, player_motion.position };
+    for (vec2 offset : hull_offsets) {
+        hull_box.min = min(hull_box.min, player_motion.position + offset);
+        hull_box.max = max(hull_box.max, player_motion.position + offset);
+    }
+    nearby_platforms.clear();
+    statics.tree.query(hull_box, [&](unsigned int s) {
+        if (registry.solid_platforms.has(statics.colliders[s]))
+            nearby_platforms.push_back(statics.colliders[s]);
+    });
+
+    for (Entity entity : nearby_platforms) {
+        MotionRef solid_motion = registry.motions.get(entity);
+        if (solid_motion.angle == 0.f)
+            continue;
 
-        vec2 right_line_pos = {solid_motion.position.x + solid_motion.scale.x/2, solid_motion.position.y};
-        vec2 left_line_pos = {solid_motion.position.x - solid_motion.scale.x/2, solid_motion.position.y};
-        vec2 top_line_pos = {solid_motion.position.x, solid_motion.position.y - solid_motion.scale.y/2};
-        vec2 bottom_line_pos = {solid_motion.position.x, solid_motion.position.y + solid_motion.scale.y/2};
+        for (vec2 offset : hull_offsets) {
+            vec2 worldPos2D = player_motion.position + offset;
 
-        for (uint i=0; i< player_vertices; i = i+48) {
-            vec3 meshPosition = meshes->vertices.at(i).position;
-            vec3 worldPosition = transform.mat * meshPosition;
-            vec2 worldPos2D = {worldPosition.x + player_motion.position.x,
-                               worldPosition.y + player_motion.position.y};
+            // Handled above
+            if (worldPos2D.x < 0 || player_motion.position.y > window_height_px + player_motion.scale.y/2)
+                continue;
 
             bool right = worldPos2D.x > solid_motion.position.x + solid_motion.scale.x/2;
             bool left = worldPos2D.x < solid_motion.position.x - solid_motion.scale.x/2;
@@ -175,35 +505,26 @@ void PhysicsSystem::step(float elapsed_ms, float window_width_px, float window_h
             shortestD = min(shortestD, distanceR);
             shortestD = min(shortestD, distanceB);
 
-            if (solid_motion.angle != 0.f) {
-                if (worldPos2D.x < 0) {
-                    player_motion.position.x = -player_motion.scale.x / 2;
-                } else if (player_motion.position.y > window_height_px + player_motion.scale.y/2) {
-                    player_motion.velocity.y = 0;
-                    player_motion.position.y = window_height_px + player_motion.scale.y/2;
-                }
-                else if (within && shortestD == distanceT &&
-                        player_motion.position.x >= solid_motion.position.x - solid_motion.scale.x/2 - 16 &&
-                        player_motion.position.x <= solid_motion.position.x + solid_motion.scale.x/2 + 12.5) {
-                    player_motion.velocity.y = 0;
-                    player_motion.position.y = solid_motion.position.y - solid_motion.scale.y/2 + player_motion.scale.y / 2;
-                }
-                else if (within && shortestD == distanceB) {
-                    player_motion.velocity.y = -player_motion.velocity.y/2;
-                    player_motion.position.y += 1.0f;
-                }
-                else if (within && shortestD == distanceL &&
-                        player_motion.position.y <= solid_motion.position.y + solid_motion.scale.y/2 - player_motion.scale.y / 2) {
-                    player_motion.velocity.x = 0;
-                    player_motion.position.x -= 1.f;
-                }
-                else if (within && shortestD == distanceR &&
-                        player_motion.position.y <= solid_motion.position.y + solid_motion.scale.y/2 - player_motion.scale.y / 2) {
-                    player_motion.velocity.x = 0;
-                    player_motion.position.x += 1.f;
-                }
+            if (within && shortestD == distanceT &&
+                    player_motion.position.x >= solid_motion.position.x - solid_motion.scale.x/2 - 16 &&
+                    player_motion.position.x <= solid_motion.position.x + solid_motion.scale.x/2 + 12.5) {
+                player_motion.velocity.y = 0;
+                player_motion.position.y = solid_motion.position.y - solid_motion.scale.y/2 + player_motion.scale.y / 2;
+            }
+            else if (within && shortestD == distanceB) {
+                player_motion.velocity.y = -player_motion.velocity.y/2;
+                player_motion.position.y += 1.0f;
+            }
+            else if (within && shortestD == distanceL &&
+                    player_motion.position.y <= solid_motion.position.y + solid_motion.scale.y/2 - player_motion.scale.y / 2) {
+                player_motion.velocity.x = 0;
+                player_motion.position.x -= 1.f;
+            }
+            else if (within && shortestD == distanceR &&
+                    player_motion.position.y <= solid_motion.position.y + solid_motion.scale.y/2 - player_motion.scale.y / 2) {
+                player_motion.velocity.x = 0;
+                player_motion.position.x += 1.f;
             }
-
         }
     }
 
@@ -211,53 +532,24 @@ void PhysicsSystem::step(float elapsed_ms, float window_width_px, float window_h
 	/***************************************************************************************
 	TEMP COLLISION CODE FOR TESTING MOVEMENT ABOVE
 	****************************************************************************************/
+}
 
+void PhysicsSystem::draw_debug()
+{
 	//TODO MESH Collision Debug
-
-    ComponentContainer<DebugComponent> &debug_container = registry.debugComponents;
-
-	// debugging of bounding boxes
-	if (debugging.in_debug_mode)
+	if (!debugging.in_debug_mode)
+		return;
+	// The points the platform test uses, as of the last step
+	MotionRef player_motion = registry.motions.get(registry.players.entities[0]);
+	for (vec2 offset : hull_offsets)
+		debug_draw.point(player_motion.position + offset);
+
+	// Bounding boxes
+	ComponentContainer<Motion>& motion_container = registry.motions;
+	const MotionStreams& streams = motion_container.components;
+	for (uint i = 0; i < motion_container.entities.size(); i++)
 	{
-		Entity player_entity = registry.players.entities[0];
-		Motion& player_motion = registry.motions.get(player_entity);
-
-        Transform transform;
-        transform.translate(vec3(player_motion.position.x, player_motion.position.y, 1.0));
-        transform.rotate(player_motion.angle);
-        transform.scale(player_motion.scale);
-
-        auto& meshes = registry.meshPtrs.get(player_entity);
-        uint player_vertices = meshes -> vertices.size();
-        for (uint i = 0; i < player_vertices; i = i+500) {
-            vec3 meshPosition = meshes->vertices.at(i).position;
-            vec3 worldPosition = transform.mat *  meshPosition;
-            vec2 worldPos2D = {worldPosition.x + player_motion.position.x, worldPosition.y + player_motion.position.y};
-
-            vec2 line_scale = {5, 5};
-            createLine(worldPos2D, line_scale);
-        }
-        
-		uint size_before_adding_new = (uint)motion_container.components.size();
-		for (uint i = 0; i < size_before_adding_new; i++)
-		{
-			Motion& motion_i = motion_container.components[i];
-			Entity entity_i = motion_container.entities[i];
-
-            if (!debug_container.has(entity_i)) {
-                if (!registry.backgrounds.has(entity_i)) {
-
-                    // visualize the radius with two axis-aligned lines
-                    const vec2 bonding_box = get_bounding_box(motion_i);
-                    vec2 line_scale1 = {bonding_box.x, 5};
-                    createLine({motion_i.position.x, motion_i.position.y + bonding_box.y / 2 }, line_scale1);
-                    createLine({motion_i.position.x, motion_i.position.y - bonding_box.y / 2 }, line_scale1);
-                    vec2 line_scale2 = {5, bonding_box.y};
-                    createLine({motion_i.position.x + bonding_box.x / 2 , motion_i.position.y}, line_scale2);
-                    createLine({motion_i.position.x - bonding_box.x / 2 , motion_i.position.y}, line_scale2);
-                }
-            }
-		}
+		if (!registry.backgrounds.has(motion_container.entities[i]))
+			debug_draw.box(get_aabb(streams.positions[i], streams.scales[i]));
 	}
-
 }
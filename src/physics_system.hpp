@@ -5,20 +5,153 @@
 #include "components.hpp"
 #include "tiny_ecs_registry.hpp"
 #include "subject.hpp"
+#include "broadphase.hpp"
+#include "narrowphase.hpp"
+#include "worker_pool.hpp"
+#include "contacts.hpp"
 
 const float GRAVITY_ACCEL = 500.f;
 
-// A simple physics system that moves rigid bodies and checks for collision
+// The simulation advances in steps of this length, independent of the frame rate
+const float FIXED_STEP_MS = 1000.f / 60.f;
+// Steps run to catch up after a long frame at most, the rest of the time is dropped
+const int MAX_STEPS_PER_FRAME = 5;
+
+// A dynamic body without acceleration moving slower than this, in pixels per second, for SLEEP_DELAY_MS
+// falls asleep
+const float SLEEP_SPEED = 5.f;
+const float SLEEP_DELAY_MS = 500.f;
+
+// Integration runs on the worker pool from this many awake dynamic bodies on, for fewer handing the
+// chunks to the threads costs more than it saves
+const size_t PARALLEL_INTEGRATION_BODIES = 4096;
+
+// The first body a ray runs into
+struct RaycastHit
+{
+	Entity entity;
+	float time = 0.f; // fraction of the ray up to the body, 0 if the ray starts inside it
+	vec2 point = { 0.f, 0.f }; // where the ray enters the body's box
+};
+
+// A simple physics system that moves rigid bodies and checks for collision. Observers are notified with
+// a COLLISION_BEGIN event when two bodies start touching and a COLLISION_END event when they stop.
 class PhysicsSystem: public Subject
 {
 public:
     void step(float elapsed_ms, float window_width_px, float window_height_px);
+	// Draws the bounding boxes and the player's hull points with debug_draw in debug mode. Once per
+	// fixed step, after its substeps, so the shapes aren't drawn once per substep.
+	void draw_debug();
+
+	// Into how many substeps a step of 'step_ms' is split, so that no colliding body moves more than
+	// half its size per substep and fast bodies don't pass through others. 1 when nothing is that fast.
+	int substeps(float step_ms) const;
+	// Upper bound of substeps, 1 turns substepping off
+	void set_max_substeps(int count) { max_substeps = count < 1 ? 1 : count; }
 
 
 	PhysicsSystem()
 	{
+		set_broadphase(debugging.broadphase);
 	}
+
+	// Selects how candidate collision pairs are found, the strategies give the same collisions
+	void set_broadphase(BROADPHASE kind);
+	BROADPHASE get_broadphase() const { return broadphase_kind; }
+
+	// Queries on the boxes of the bodies with a CollisionFilter, as they are after the last step. Bodies
+	// created or removed since are taken into account. Only bodies on a layer in 'mask', bits of
+	// CollisionFilter::category, are reported, whatever they collide with.
+	// The bodies whose box contains 'point', into 'hits'
+	void queryPoint(vec2 point, uint32_t mask, std::vector<Entity>& hits);
+	// The bodies whose box overlaps 'box', touching counts, into 'hits'
+	void queryAABB(const AABB& box, uint32_t mask, std::vector<Entity>& hits);
+	// The first body the segment from 'origin' to 'origin + direction' touches, false if there is none
+	bool raycast(vec2 origin, vec2 direction, uint32_t mask, RaycastHit& hit);
+
+private:
+	// Broadphase state, kept between steps so that collision detection doesn't allocate
+	AllPairs all_pairs;
+	SpatialHash spatial_hash;
+	SweepAndPrune sweep_and_prune;
+	Broadphase* broadphase = nullptr;
+	BROADPHASE broadphase_kind;
+
+	int max_substeps = 4;
+
+	// Bodies that don't move, in a tree that is only rebuilt when their set changes
+	struct StillBodies
+	{
+		AABBTree tree;
+		std::vector<Entity> entities; // the set as of the last build
+		// The ones with a CollisionFilter, boxes[i] is the box of colliders[i]
+		std::vector<Entity> colliders;
+		std::vector<AABB> boxes;
+		std::vector<CollisionFilter> filters;
+
+		// Rebuilds the tree if 'bodies' differ from the last build, returns whether it did
+		bool update(const std::vector<Entity>& bodies);
+		// Adds the colliders whose box is no longer the one the tree was built with to 'moved'
+		void find_moved(std::vector<Entity>& moved) const;
+	};
+	StillBodies statics;
+	StillBodies sleepers;
+
+	// The bodies with a CollisionFilter that aren't static, in a tree for queries only. Rebuilt by the
+	// first query after a step or after filtered bodies came or went, static ones are in 'statics'.
+	struct QueryBodies
+	{
+		AABBTree tree;
+		std::vector<Entity> filtered; // every entity with a CollisionFilter as of the last build
+		std::vector<Entity> entities; // boxes[i] and categories[i] are those of entities[i]
+		std::vector<AABB> boxes;
+		std::vector<uint32_t> categories;
+		bool stale = true;
+	};
+	QueryBodies queried;
+	void update_query_tree();
+	bool rotated_platforms = false; // the player is kept inside the level only if there are any
+
+	// Player against platforms, the player's hull moved to its position and the platforms near it
+	std::vector<vec2> hull_offsets;
+	std::vector<Entity> nearby_platforms;
+
+	void update_static_tree();
+	// Moves a body by 'displacement', stopping at the first solid platform in the way. Only reads the
+	// static tree, so bodies can be moved on several threads at once.
+	void move_swept(vec2& position, vec2 scale, vec2& velocity, vec2 displacement) const;
+
+	// The awake dynamic bodies of a step, gathered into contiguous streams that are integrated in chunks
+	// of 64. Bit k of a chunk's mask stands for body 64 * chunk + k.
+	struct IntegrationStreams
+	{
+		std::vector<Entity> entities;
+		std::vector<uint> motion_indices;
+		std::vector<vec2> positions;
+		std::vector<vec2> velocities;
+		std::vector<vec2> accelerations;
+		std::vector<vec2> scales;
+		std::vector<float> still_ms;
+		std::vector<uint64_t> gravity_masks; // the body has Gravity
+		std::vector<uint64_t> sleep_masks; // the body falls asleep, set by integrate_chunk
+	};
+	IntegrationStreams integration;
+	WorkerPool workers;
+	// Integrates the bodies of one chunk, chunks can run in any order and on any thread
+	void integrate_chunk(size_t chunk, float step_seconds, float elapsed_ms);
+	std::vector<Entity> waking;
+	ContactCache contacts;
+	std::vector<AABB> collider_boxes;
+	std::vector<unsigned int> collider_indices; // packed Motion index of every box
+	std::vector<CollisionFilter> collider_filters;
+	std::vector<unsigned int> collider_ids; // entity index of every box, keeps the broadphase's state with its body
+	std::vector<BodyPair> candidate_pairs;
 };
 
+// Wakes a sleeping body right away. A sleeping body whose position, velocity or acceleration was set
+// is also woken at the start of the next step, until then its contacts use the box it fell asleep with.
+void wake_up(Entity entity);
+
 vec2 get_bounding_box(const Motion& motion);
 bool collides(const Motion& motion1, const Motion& motion2);
\ No newline at end of file
@@ -5,13 +5,15 @@
 #include "tiny_ecs_registry.hpp"
 #include "tiny_ecs.hpp"
 #include "common.hpp"
+#include "debug_draw.hpp"
 
 
 
 void RenderSystem::drawTexturedMesh(Entity entity,
+									const Motion &motion,
+									const RenderRequest &render_request,
 									const mat3 &projection)
 {
-	Motion &motion = registry.motions.get(entity);
 	// Transformation code, see Rendering and Transformation in the template
 	// specification for more info Incrementally updates transformation matrix,
 	// thus ORDER IS IMPORTANT
@@ -21,9 +23,6 @@ void RenderSystem::drawTexturedMesh(Entity entity,
 	transform.scale(motion.scale);
 
 
-	assert(registry.renderRequests.has(entity));
-	const RenderRequest &render_request = registry.renderRequests.get(entity);
-
 	const GLuint used_effect_enum = (GLuint)render_request.used_effect;
 	assert(used_effect_enum != (GLuint)EFFECT_ASSET_ID::EFFECT_COUNT);
 	const GLuint program = (GLuint)effects[used_effect_enum];
@@ -76,9 +75,8 @@ void RenderSystem::drawTexturedMesh(Entity entity,
 		glActiveTexture(GL_TEXTURE0);
 		gl_has_errors();
 
-		assert(registry.renderRequests.has(entity));
 		GLuint texture_id =
-			texture_gl_handles[(GLuint)registry.renderRequests.get(entity).used_texture];
+			texture_gl_handles[(GLuint)render_request.used_texture];
 
 		glBindTexture(GL_TEXTURE_2D, texture_id);
 		gl_has_errors();
@@ -90,7 +88,7 @@ void RenderSystem::drawTexturedMesh(Entity entity,
 
 
         if (render_request.used_effect == EFFECT_ASSET_ID::SICKMAN) {
-            ComponentContainer<Sickman> sickmen = registry.sickmen;
+            ComponentContainer<Sickman>& sickmen = registry.sickmen;
             GLint move_uloc = glGetUniformLocation(program, "move");
             int i = 0;
             if (sickmen.components.size() > 0) {
@@ -142,7 +140,8 @@ void RenderSystem::drawTexturedMesh(Entity entity,
 
 	// Getting uniform locations for glUniform* calls
 	GLint color_uloc = glGetUniformLocation(program, "fcolor");
-	const vec3 color = registry.colors.has(entity) ? registry.colors.get(entity) : vec3(1);
+	const vec3* custom_color = registry.colors.find(entity);
+	const vec3 color = custom_color ? *custom_color : vec3(1);
 	glUniform3fv(color_uloc, 1, (float *)&color);
 	gl_has_errors();
 
@@ -167,6 +166,43 @@ void RenderSystem::drawTexturedMesh(Entity entity,
 	gl_has_errors();
 }
 
+void RenderSystem::drawDebug(const mat3& projection)
+{
+	const std::vector<ColoredVertex>& vertices = debug_draw.vertices();
+	if (vertices.empty())
+		return;
+
+	const GLuint program = effects[(GLuint)EFFECT_ASSET_ID::LINE];
+	glUseProgram(program);
+	gl_has_errors();
+
+	// The size changes from frame to frame, a new store also means the upload doesn't have to wait
+	// for the last frame's draw
+	GLsizeiptr size = (GLsizeiptr)(vertices.size() * sizeof(ColoredVertex));
+	glBindBuffer(GL_ARRAY_BUFFER, debug_vertex_buffer);
+	glBufferData(GL_ARRAY_BUFFER, size, vertices.data(), GL_STREAM_DRAW);
+	gl_has_errors();
+
+	GLint in_position_loc = glGetAttribLocation(program, "in_position");
+	GLint in_color_loc = glGetAttribLocation(program, "in_color");
+	glEnableVertexAttribArray(in_position_loc);
+	glVertexAttribPointer(in_position_loc, 3, GL_FLOAT, GL_FALSE, sizeof(ColoredVertex), (void*)0);
+	glEnableVertexAttribArray(in_color_loc);
+	glVertexAttribPointer(in_color_loc, 3, GL_FLOAT, GL_FALSE, sizeof(ColoredVertex), (void*)sizeof(vec3));
+	gl_has_errors();
+
+	// The vertices are in world coordinates already
+	const mat3 identity = mat3(1.f);
+	const vec3 white = vec3(1.f);
+	glUniformMatrix3fv(glGetUniformLocation(program, "transform"), 1, GL_FALSE, (float*)&identity);
+	glUniformMatrix3fv(glGetUniformLocation(program, "projection"), 1, GL_FALSE, (float*)&projection);
+	glUniform3fv(glGetUniformLocation(program, "fcolor"), 1, (float*)&white);
+	gl_has_errors();
+
+	glDrawArrays(GL_TRIANGLES, 0, (GLsizei)vertices.size());
+	gl_has_errors();
+}
+
 // draw the intermediate texture to the screen, with some distortion to simulate
 // water
 //TODO Remove water and add SKY
@@ -230,10 +266,48 @@ void RenderSystem::drawToScreen()
 	gl_has_errors();
 }
 
+// Draw passes, back to front
+enum class RENDER_LAYER {
+	BACKGROUND = 0,
+	WORLD = 1,
+	STORY = 2,
+	HELP = 3
+};
+
+// Draw order key of a render request: the pass in the top 16 bits, the depth within the pass next,
+// then the order the requests were made in, so that overlapping sprites keep which one is on top
+static uint64_t render_key(Entity entity, const RenderRequest& render_request)
+{
+	RENDER_LAYER layer = RENDER_LAYER::WORLD;
+	uint64_t depth = 0;
+	if (const Background* background = registry.backgrounds.find(entity))
+	{
+		layer = RENDER_LAYER::BACKGROUND;
+		// Higher background layers are further away and drawn first
+		depth = 0xffff - (uint64_t)std::min(std::max(background->layer, 0), 0xffff);
+	}
+	else if (registry.storyComponents.has(entity))
+		layer = RENDER_LAYER::STORY;
+	else if (registry.helpComponent.has(entity))
+		layer = RENDER_LAYER::HELP;
+
+	return ((uint64_t)layer << 48) | (depth << 32) | (uint64_t)render_request.order;
+}
+
+vec2 RenderSystem::interpolated_position(const MotionRef& motion) const
+{
+	// Bodies that appeared during the current step have nowhere to come from
+	if (std::isnan(motion.previous_position.x))
+		return motion.position;
+	return motion.previous_position + (motion.position - motion.previous_position) * interpolation;
+}
+
 // Render our game world
 // http://www.opengl-tutorial.org/intermediate-tutorials/tutorial-14-render-to-texture/
-void RenderSystem::draw()
+void RenderSystem::draw(float interpolation)
 {
+	this->interpolation = interpolation;
+
 	// Getting size of window
 	int w, h;
 	glfwGetFramebufferSize(window, &w, &h);
@@ -258,33 +332,20 @@ void RenderSystem::draw()
 							  // sprites back to front
 	gl_has_errors();
 	mat3 projection_2D = createProjectionMatrix();
-    // Render the backgrounds
-    for (Entity entity: registry.backgrounds.entities) {
-        drawTexturedMesh(entity, projection_2D);
-    }
-
-	// Draw all textured meshes that have a position and size component
-	for (Entity entity : registry.renderRequests.entities)
-	{
-		if (!registry.motions.has(entity) || registry.backgrounds.has(entity)
-			|| registry.helpComponent.has(entity) || registry.storyComponents.has(entity))
-			continue;
-		// Note, its not very efficient to access elements indirectly via the entity
-		// albeit iterating through all Sprites in sequence. A good point to optimize
-		drawTexturedMesh(entity, projection_2D);
-	}
 
-    for (Entity entity : registry.renderRequests.entities) {
-        if (registry.storyComponents.has(entity)) {
-            drawTexturedMesh(entity, projection_2D);
-        }
-    }
+	// Backgrounds first, then the world, the story boxes and the help screen on top.
+	// The sort is linear and leaves an unchanged order alone. Drawing walks the render requests
+	// and motions of the group side by side.
+	registry.renderables.sort_by_key([](Entity entity, const RenderRequest& render_request, MotionRef) {
+		return render_key(entity, render_request);
+	});
+	registry.renderables.each([&](Entity entity, RenderRequest& render_request, MotionRef motion) {
+		Motion drawn = motion;
+		drawn.position = interpolated_position(motion);
+		drawTexturedMesh(entity, drawn, render_request, projection_2D);
+	});
 
-    for (Entity entity : registry.renderRequests.entities) {
-        if (registry.helpComponent.has(entity)) {
-            drawTexturedMesh(entity, projection_2D);
-        }
-    }
+	drawDebug(projection_2D);
 
 	/*for (Entity entity : registry.emitters.entities) {
 		drawParticles(entity, projection_2D);
@@ -314,8 +375,8 @@ mat3 RenderSystem::createProjectionMatrix()
 	// Get player position in world coordinates
 	assert(registry.players.entities.size() > 0);
 	Entity& player = registry.players.entities[0];
-	Motion& motion = registry.motions.get(player);
-	vec2 pos = motion.position;
+	MotionRef motion = registry.motions.get(player);
+	vec2 pos = interpolated_position(motion);
 
 	float tx, ty;
 	float slope = (-3.f - (-1.f)) / (1.5f * right - 0.5f * right);
@@ -342,14 +403,14 @@ void RenderSystem::addBackground(
         int game_h, int pos_x, int pos_y, vec2 scale) {
 
     // Reserve en entity
-    auto entity = Entity();
+    auto entity = Entity::create();
 
     // Store a reference to the potentially re-used mesh object
     Mesh& mesh = renderer->getMesh(GEOMETRY_BUFFER_ID::SPRITE);
     registry.meshPtrs.emplace(entity, &mesh);
 
     // Initialize the position, scale, and physics components
-    auto& motion = registry.motions.emplace(entity);
+    auto motion = registry.motions.emplace(entity);
     motion.angle = 0.f;
     motion.velocity = { 0, 0 };
     motion.position = {pos_x, pos_y};
@@ -368,24 +429,22 @@ void RenderSystem::addBackground(
 }
 
 void RenderSystem::updateBackgrounds(float time_ms, int game_w, int game_h) {
-//    Motion& motion = registry.motions.get(bg_entity);
+//    MotionRef motion = registry.motions.get(bg_entity);
 //    motion.position.x -= scroll_speed;
 //    if (motion.position.x < -1000) {
 //        motion.position.x = 0;
 //    }
     Entity& player = registry.players.entities[0];
-    Motion& player_motion = registry.motions.get(player);
+    MotionRef player_motion = registry.motions.get(player);
 
     // TODO: Add condition to check for boundaries (do after initial implementation is working)
-    for (auto& bg : registry.backgrounds.entities) {
-		if (level_state == LEVEL_STATE_SELECTOR) {
-			auto& motion = registry.motions.get(bg);
-			auto& bg_component = registry.backgrounds.get(bg);
-			if (bg_component.layer >= 2 && player_motion.position.x > (game_w / 2) && player_motion.position.x < (2 * game_w) - (game_w / 2)) {
-				motion.position.x += player_motion.velocity.x * time_ms / 1000 / (bg_component.layer * 2);
-			}
-		}
-    }
+    if (level_state != LEVEL_STATE_SELECTOR)
+        return;
+    registry.view<Background, Motion>().each([&](Entity, Background& bg_component, MotionRef motion) {
+        if (bg_component.layer >= 2 && player_motion.position.x > (game_w / 2) && player_motion.position.x < (2 * game_w) - (game_w / 2)) {
+            motion.position.x += player_motion.velocity.x * time_ms / 1000 / (bg_component.layer * 2);
+        }
+    });
 }
 
 void RenderSystem::removeBackgrounds() {
@@ -89,6 +89,8 @@ class RenderSystem {
 	std::array<GLuint, geometry_count> vertex_buffers;
 	std::array<GLuint, geometry_count> index_buffers;
 	std::array<Mesh, geometry_count> meshes;
+	// Refilled with the debug_draw vertices every frame
+	GLuint debug_vertex_buffer;
 
 public:
 	// Initialize the window
@@ -117,8 +119,9 @@ public:
 	// Destroy resources associated to one or all entities created by the system
 	~RenderSystem();
 
-	// Draw all entities
-	void draw();
+	// Draw all entities, 'interpolation' of the way from where bodies were when the current fixed
+	// step started to where they are now
+	void draw(float interpolation = 1.f);
 
 	mat3 createProjectionMatrix();
 
@@ -144,9 +147,12 @@ public:
 
 private:
 	// Internal drawing functions for each entity type
-	void drawTexturedMesh(Entity entity, const mat3& projection);
+	void drawTexturedMesh(Entity entity, const Motion& motion, const RenderRequest& render_request, const mat3& projection);
 	void drawToScreen();
+	// Draws everything in debug_draw in one call, on top of the entities
+	void drawDebug(const mat3& projection);
 	void drawParticles(Entity entity, const mat3& projection);
+	vec2 interpolated_position(const MotionRef& motion) const;
 
 	// Window handle
 	GLFWwindow* window;
@@ -155,6 +161,8 @@ private:
 
 	bool render_particles;
 
+	float interpolation = 1.f; // of the frame being drawn, see draw()
+
 	// Screen texture handles
 	GLuint frame_buffer;
 	GLuint off_screen_render_buffer_color;
@@ -131,6 +131,7 @@ void RenderSystem::initializeGlMeshes()
 			meshes[(int)geom_index].vertices,
 			meshes[(int)geom_index].vertex_indices,
 			meshes[(int)geom_index].original_size);
+		Mesh::computeCollisionHull(meshes[(int)geom_index].vertices, meshes[(int)geom_index].collision_hull);
 
 		bindVBOandIBO(geom_index,
 			meshes[(int)geom_index].vertices, 
@@ -166,6 +167,7 @@ void RenderSystem::initializeGlGeometryBuffers()
 	glGenBuffers((GLsizei)vertex_buffers.size(), vertex_buffers.data());
 	// Index Buffer creation.
 	glGenBuffers((GLsizei)index_buffers.size(), index_buffers.data());
+	glGenBuffers(1, &debug_vertex_buffer);
 
 	// Index and Vertex buffer data initialization.
 	initializeGlMeshes();
@@ -255,6 +257,7 @@ RenderSystem::~RenderSystem()
 	// but it's polite to clean after yourself.
 	glDeleteBuffers((GLsizei)vertex_buffers.size(), vertex_buffers.data());
 	glDeleteBuffers((GLsizei)index_buffers.size(), index_buffers.data());
+	glDeleteBuffers(1, &debug_vertex_buffer);
 	glDeleteTextures((GLsizei)texture_gl_handles.size(), texture_gl_handles.data());
 	glDeleteTextures(1, &off_screen_render_buffer_color);
 	glDeleteRenderbuffers(1, &off_screen_render_buffer_depth);
@@ -275,6 +278,7 @@ RenderSystem::~RenderSystem()
 // Initialize the screen texture from a standard sprite
 bool RenderSystem::initScreenTexture()
 {
+	screen_state_entity = Entity::create();
 	registry.screenStates.emplace(screen_state_entity);
 
 	int width, height;
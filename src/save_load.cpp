@@ -15,7 +15,7 @@ void saveState(int level, int state) {
     // j["test"] = a;
     j["level"] = level;
     Entity player = registry.players.entities[0];
-    Motion& player_motion = registry.motions.get(player);
+    MotionRef player_motion = registry.motions.get(player);
     Player player_player = registry.players.components[0];
     j["player"]["motion"]["position"] = {{"x", std::to_string(player_motion.position.x)}, {"y", std::to_string(player_motion.position.y)}};
     j["player"]["motion"]["angle"] = player_motion.angle;
@@ -30,7 +30,7 @@ void saveState(int level, int state) {
     for (auto i = 0; i < registry.viruses.entities.size(); i++) {
         json object = json::object();
         Entity virus = registry.viruses.entities[i];
-        Motion& virus_motion = registry.motions.get(virus);
+        MotionRef virus_motion = registry.motions.get(virus);
         Virus virus_component = registry.viruses.components[i];
 
         // object["dead"] to check if virus is dead, need to implement later
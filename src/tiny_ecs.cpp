@@ -1,5 +1,101 @@
 // internal
 #include "tiny_ecs.hpp"
 
-// All we need to store besides the containers is the id of every entity and callbacks to be able to remove entities across containers
-unsigned int Entity::id_count = 1;
\ No newline at end of file
+// All we need to store besides the containers is the generation of every entity index and the
+// indices that are free for re-use. Index 0 is reserved so that the null entity is never valid.
+std::vector<unsigned int> Entity::generations = { 0 };
+std::deque<unsigned int> Entity::free_indices;
+
+const unsigned int Entity::index_bits;
+const unsigned int Entity::index_mask;
+const unsigned int Entity::max_generation;
+const unsigned int Entity::min_free_indices;
+const unsigned int SparseSet::page_bits;
+const unsigned int SparseSet::page_size;
+const unsigned int SparseSet::null_index;
+
+Entity Entity::create()
+{
+	Entity e;
+	unsigned int index;
+	if (free_indices.size() > min_free_indices)
+	{
+		index = free_indices.front();
+		free_indices.pop_front();
+	}
+	else
+	{
+		index = (unsigned int)generations.size();
+		assert(index <= index_mask && "Ran out of entity indices");
+		generations.push_back(0);
+	}
+	e.id = (generations[index] << index_bits) | index;
+	return e;
+}
+
+void Entity::destroy(Entity e)
+{
+	if (!is_alive(e))
+		return;
+	unsigned int index = e.index();
+	// Wraps around, see the class comment for when an old handle can alias again
+	generations[index] = (generations[index] + 1) & max_generation;
+	free_indices.push_back(index);
+}
+
+bool Entity::is_alive(Entity e)
+{
+	unsigned int index = e.index();
+	return index != 0 && index < generations.size() && generations[index] == e.generation();
+}
+
+void SparseSet::radix_sort_keys()
+{
+	size_t n = sort_keys.size();
+	sort_order.resize(n);
+	for (unsigned int i = 0; i < n; i++)
+		sort_order[i] = i;
+	if (n == 0)
+		return;
+	sort_keys_scratch.resize(n);
+	sort_order_scratch.resize(n);
+
+	// Histograms of all eight key bytes in a single pass
+	size_t counts[8][256] = {};
+	for (uint64_t key : sort_keys)
+		for (unsigned int digit = 0; digit < 8; digit++)
+			counts[digit][(key >> (8 * digit)) & 0xff]++;
+
+	for (unsigned int digit = 0; digit < 8; digit++)
+	{
+		unsigned int shift = 8 * digit;
+		size_t* count = counts[digit];
+		// A byte that every key shares doesn't change the order
+		if (count[(sort_keys[0] >> shift) & 0xff] == n)
+			continue;
+
+		size_t offset = 0;
+		for (unsigned int bucket = 0; bucket < 256; bucket++)
+		{
+			size_t bucket_size = count[bucket];
+			count[bucket] = offset;
+			offset += bucket_size;
+		}
+		for (size_t i = 0; i < n; i++)
+		{
+			size_t destination = count[(sort_keys[i] >> shift) & 0xff]++;
+			sort_keys_scratch[destination] = sort_keys[i];
+			sort_order_scratch[destination] = sort_order[i];
+		}
+		sort_keys.swap(sort_keys_scratch);
+		sort_order.swap(sort_order_scratch);
+	}
+}
+
+void SparseSet::reorder_entities(size_t count)
+{
+	sort_entities.resize(count);
+	for (unsigned int i = 0; i < count; i++)
+		sort_entities[i] = entities[sort_order[i]];
+	std::copy(sort_entities.begin(), sort_entities.end(), entities.begin());
+}
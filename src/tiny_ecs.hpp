@@ -2,49 +2,190 @@
 
 #include <algorithm>
 #include <vector>
-#include <unordered_map>
+#include <deque>
 #include <set>
 #include <functional>
 #include <typeindex>
+#include <typeinfo>
+#include <cstdio>
+#include <tuple>
+#include <type_traits>
+#include <optional>
+#include <utility>
 #include <assert.h>
+#include <cstdint>
 
 // Unique identifyer for all entities
+// A handle packs the slot index into the low bits and a generation counter into the high bits.
+// Destroyed indices are recycled through a first in, first out queue; the generation is bumped on
+// every reuse so handles to a destroyed entity can be told apart from its successor.
+// An index is only reused once min_free_indices others are waiting, so an entity that is created
+// and destroyed every frame cycles through all of them instead of wearing out one index. The
+// generation wraps around: a stale handle can alias a live entity again only after its index was
+// reused 4096 times, which takes at least min_free_indices * 4096 (about 4 million) destroys.
 class Entity
 {
-	unsigned int id;
-	static unsigned int id_count; // starts from 1, entit 0 is the default initialization
+	unsigned int id; // 0 is the null entity, index 0 is never handed out
+	static std::vector<unsigned int> generations; // current generation of every index
+	static std::deque<unsigned int> free_indices; // oldest first
 public:
-	Entity()
+	static const unsigned int index_bits = 20;
+	static const unsigned int index_mask = (1u << index_bits) - 1;
+	static const unsigned int max_generation = (1u << (32 - index_bits)) - 1;
+	static const unsigned int min_free_indices = 1024;
+
+	// Default construction yields the null entity and does not allocate an id, use create()
+	Entity() : id(0) {}
+
+	// Allocate a fresh handle, re-using the index of a destroyed entity when possible
+	static Entity create();
+	// Release the index of e for re-use, handles to e become stale
+	static void destroy(Entity e);
+	// True if e was created and not destroyed since
+	static bool is_alive(Entity e);
+	// Number of indices currently handed out, bounded by the peak number of live entities plus
+	// min_free_indices
+	static unsigned int capacity() { return (unsigned int)generations.size(); }
+
+	unsigned int index() const { return id & index_mask; }
+	unsigned int generation() const { return id >> index_bits; }
+
+	operator unsigned int() const { return id; } // this enables automatic casting to int
+};
+
+// Bit set of the component types an entity has, bit i stands for the component type with id i
+typedef uint64_t Signature;
+const unsigned int MAX_COMPONENT_TYPES = 64;
+
+// Position of T in std::tuple<Ts...>, the registry derives compile-time component ids from it
+template <typename T, typename Tuple>
+struct tuple_index;
+template <typename T, typename... Ts>
+struct tuple_index<T, std::tuple<T, Ts...>> { static constexpr unsigned int value = 0; };
+template <typename T, typename U, typename... Ts>
+struct tuple_index<T, std::tuple<U, Ts...>> { static constexpr unsigned int value = 1 + tuple_index<T, std::tuple<Ts...>>::value; };
+
+// Receives the structural changes of the containers a group owns, see OwningGroup
+struct GroupInterface
+{
+	virtual void on_insert(Entity e) = 0; // after e got a component of an owned type
+	virtual void on_remove(Entity e) = 0; // before e loses a component of an owned type
+	virtual void on_clear() = 0; // after an owned container was cleared
+};
+
+// Maps entities to positions in a packed array without hashing.
+// The sparse side is split into fixed size pages indexed by the entity id. A page is only
+// allocated once an entity in its id range is inserted, so a few high ids don't blow up memory.
+class SparseSet
+{
+protected:
+	static const unsigned int page_bits = 12;
+	static const unsigned int page_size = 1u << page_bits;
+	static const unsigned int null_index = ~0u;
+
+	// sparse_pages[index / page_size][index % page_size] is the dense position of an entity index, or null_index
+	std::vector<std::vector<unsigned int>> sparse_pages;
+
+	unsigned int& sparse_slot(unsigned int id)
 	{
-		id = id_count++;
-		// Note, indices of already deleted entities arent re-used in this simple implementation.
+		unsigned int page = id >> page_bits;
+		if (page >= sparse_pages.size())
+			sparse_pages.resize(page + 1);
+		if (sparse_pages[page].empty())
+			sparse_pages[page].assign(page_size, null_index);
+		return sparse_pages[page][id & (page_size - 1)];
+	}
+
+	// Dense position of an entity, or null_index if it is not contained
+	unsigned int dense_index(unsigned int id) const
+	{
+		unsigned int page = id >> page_bits;
+		if (page >= sparse_pages.size() || sparse_pages[page].empty())
+			return null_index;
+		return sparse_pages[page][id & (page_size - 1)];
+	}
+
+	// Scratch space of sort_by_key, kept between calls so that sorting every frame doesn't allocate
+	std::vector<uint64_t> sort_keys, sort_keys_scratch;
+	std::vector<unsigned int> sort_order, sort_order_scratch;
+	std::vector<Entity> sort_entities;
+
+	template <typename... Owned>
+	friend class OwningGroup;
+
+	// Stable LSD radix sort of sort_keys, afterwards sort_order[i] is the old packed position of the i-th smallest key
+	void radix_sort_keys();
+
+	// Rearranges the first 'count' entities by sort_order (new position -> old position),
+	// the sparse index still refers to the old positions
+	void reorder_entities(size_t count);
+
+	// Per-entity signatures shared by all containers of a registry, null for a standalone container
+	std::vector<Signature>* signatures = nullptr;
+	Signature signature_bit = 0;
+
+	void mark(Entity e)
+	{
+		if (!signatures)
+			return;
+		if (e.index() >= signatures->size())
+			signatures->resize(e.index() + 1, 0);
+		(*signatures)[e.index()] |= signature_bit;
+	}
+
+	void unmark(Entity e)
+	{
+		if (signatures)
+			(*signatures)[e.index()] &= ~signature_bit;
+	}
+
+public:
+	// The entities in packed order, entities[i] owns the i-th element of the derived container
+	std::vector<Entity> entities;
+
+	// The group that keeps its members at the front of this container, if any
+	GroupInterface* owning_group = nullptr;
+
+	// Let the container keep the bit of its component id up to date in a registry's signature table
+	void bind_signatures(std::vector<Signature>* table, unsigned int component_id)
+	{
+		assert(component_id < MAX_COMPONENT_TYPES);
+		signatures = table;
+		signature_bit = Signature(1) << component_id;
+	}
+
+	// The sparse side is keyed on the entity index, the packed entity carries the generation.
+	// A stale handle finds its index occupied by a newer generation and is rejected.
+	bool contains(Entity e) const
+	{
+		unsigned int dense = dense_index(e.index());
+		return dense != null_index && entities[dense] == e;
+	}
+
+	// Index of entity e in the packed arrays, e must be contained
+	unsigned int index_of(Entity e) const
+	{
+		assert(contains(e) && "Entity not contained in ECS registry");
+		return dense_index(e.index());
 	}
-	operator unsigned int() { return id; } // this enables automatic casting to int
 };
 
-// Common interface to refer to all containers in the ECS registry
-struct ContainerInterface
+// The array type a container keeps its components in. A component type can specialize this to be stored
+// differently, e.g. split into one array per field; the type then has to provide push_back, pop_back,
+// back, clear, size and operator[], which may return a proxy instead of a Component&.
+template <typename Component>
+struct ComponentStorage
 {
-	virtual void clear() = 0;
-	virtual size_t size() = 0;
-	virtual void remove(Entity e) = 0;
-	virtual bool has(Entity entity) = 0;
+	typedef std::vector<Component> type;
 };
 
 // A container that stores components of type 'Component' and associated entities
-template <typename Component> // A component can be any class
-class ComponentContainer : public ContainerInterface
+template <typename Component, typename Enable = void> // A component can be any class
+class ComponentContainer : public SparseSet
 {
-private:
-	// The hash map from Entity -> array index.
-	std::unordered_map<unsigned int, unsigned int> map_entity_componentID; // the entity is cast to uint to be hashable.
-	bool registered = false;
 public:
 	// Container of all components of type 'Component'
-	std::vector<Component> components;
-
-	// The corresponding entities
-	std::vector<Entity> entities;
+	typename ComponentStorage<Component>::type components;
 
 	// Constructor that registers the type
 	ComponentContainer()
@@ -52,66 +193,106 @@ public:
 	}
 
 	// Inserting a component c associated to entity e
-	inline Component& insert(Entity e, Component c, bool check_for_duplicates = true)
+	inline decltype(auto) insert(Entity e, Component c, bool check_for_duplicates = true)
 	{
-		// Usually, every entity should only have one instance of each component type
+		// Usually, every entity should only have one instance of each component type. The flag only
+		// feeds this check, it stays for the callers of emplace_with_duplicates.
 		assert(!(check_for_duplicates && has(e)) && "Entity already contained in ECS registry");
+		(void)check_for_duplicates;
 
-		map_entity_componentID[e] = (unsigned int)components.size();
+		// With duplicates the sparse slot points at the newest instance, as the hash map did
+		sparse_slot(e.index()) = (unsigned int)components.size();
 		components.push_back(std::move(c)); // the move enforces move instead of copy constructor
 		entities.push_back(e);
-		return components.back();
+		mark(e);
+		if (owning_group)
+			owning_group->on_insert(e); // may move the new component to the front
+		return components[dense_index(e.index())];
 	};
 
 	// The emplace function takes the the provided arguments Args, creates a new object of type Component, and inserts it into the ECS system
 	template<typename... Args>
-	Component& emplace(Entity e, Args &&... args) {
+	decltype(auto) emplace(Entity e, Args &&... args) {
 		return insert(e, Component(std::forward<Args>(args)...));
 	};
 	template<typename... Args>
-	Component& emplace_with_duplicates(Entity e, Args &&... args) {
+	decltype(auto) emplace_with_duplicates(Entity e, Args &&... args) {
 		return insert(e, Component(std::forward<Args>(args)...), false);
 	};
 
 	// A wrapper to return the component of an entity
-	Component& get(Entity e) {
-		assert(has(e) && "Entity not contained in ECS registry");
-		return components[map_entity_componentID[e]];
+	decltype(auto) get(Entity e) {
+		return components[index_of(e)];
 	}
 
 	// Check if entity has a component of type 'Component'
 	bool has(Entity entity) {
-		return map_entity_componentID.count(entity) > 0;
+		return contains(entity);
+	}
+
+	// What get() returns, Component& or the proxy of a storage that splits the component up
+	typedef decltype(std::declval<typename ComponentStorage<Component>::type&>()[0]) Reference;
+
+	// Combined has() and get(), returns nullptr if the entity has no component of this type. A storage
+	// that hands out proxies has no component to point at, find() then returns an std::optional of
+	// the proxy, e.g. if (auto motion = registry.motions.find(e)) motion->velocity = ...
+	auto find(Entity e) {
+		unsigned int dense = dense_index(e.index());
+		bool found = dense != null_index && entities[dense] == e;
+		if constexpr (std::is_reference<Reference>::value)
+			return found ? &components[dense] : nullptr;
+		else
+			return found ? std::optional<Reference>(components[dense]) : std::nullopt;
 	}
 
 	// Remove an component and pack the container to re-use the empty space
 	void remove(Entity e)
 	{
-		if (has(e))
-		{
-			// Get the current position
-			int cID = map_entity_componentID[e];
-
-			// Move the last element to position cID using the move operator
-			// Note, components[cID] = components.back() would trigger the copy instead of move operator
-			components[cID] = std::move(components.back());
-			entities[cID] = entities.back(); // the entity is only a single index, copy it.
-			map_entity_componentID[entities.back()] = cID;
-
-			// Erase the old component and free its memory
-			map_entity_componentID.erase(e);
-			components.pop_back();
-			entities.pop_back();
-			// Note, one could mark the id for re-use
-		}
+		if (!contains(e))
+			return;
+		if (owning_group)
+			owning_group->on_remove(e); // moves e out of the group first
+		unsigned int cID = index_of(e);
+
+		// Move the last element to position cID using the move operator
+		// Note, components[cID] = components.back() would trigger the copy instead of move operator
+		components[cID] = std::move(components.back());
+		entities[cID] = entities.back(); // the entity is only a single index, copy it.
+		sparse_slot(entities.back().index()) = cID;
+
+		// Erase the old component and free its memory
+		sparse_slot(e.index()) = null_index;
+		unmark(e);
+		components.pop_back();
+		entities.pop_back();
 	};
 
 	// Remove all components of type 'Component'
 	void clear()
 	{
-		map_entity_componentID.clear();
+		// Only touch the sparse slots in use instead of wiping every page
+		for (Entity e : entities)
+		{
+			sparse_slot(e.index()) = null_index;
+			unmark(e);
+		}
 		components.clear();
 		entities.clear();
+		if (owning_group)
+			owning_group->on_clear();
+	}
+
+	// Exchange the elements at two packed positions
+	void swap_elements(unsigned int a, unsigned int b)
+	{
+		if (a == b)
+			return;
+		Component displaced = std::move(components[a]);
+		components[a] = std::move(components[b]);
+		components[b] = std::move(displaced);
+		std::swap(entities[a], entities[b]);
+		sparse_slot(entities[a].index()) = a;
+		sparse_slot(entities[b].index()) = b;
 	}
 
 	// Report the number of components of type 'Component'
@@ -121,17 +302,559 @@ public:
 	}
 
 	// Sort the components and associated entity assignment structures by the comparisonFunction, see std::sort
+	// The comparison is on entities, e.g. [](Entity a, Entity b) { return registry.motions.get(a).position.y < ...; }
 	template <class Compare>
 	void sort(Compare comparisonFunction)
 	{
-		// First sort the entity list as desired
-		std::sort(entities.begin(), entities.end(), comparisonFunction);
-		// Now re-arrange the components (Note, creates a new vector, which may be slow! Not sure if in-place could be faster: https://stackoverflow.com/questions/63703637/how-to-efficiently-permute-an-array-in-place-using-stdswap)
-		std::vector<Component> components_new; components_new.reserve(components.size());
-		std::transform(entities.begin(), entities.end(), std::back_inserter(components_new), [&](Entity e) { return std::move(get(e)); }); // note, the get still uses the old hash map (on purpose!)
-		components = std::move(components_new); // note, we use move operations to not create unneccesary copies of objects, but memory is still allocated for the new vector
-		// Fill the new hashmap
+		assert(!owning_group && "Sort owned containers through their group");
+		// Sort positions rather than the entities themselves, so the comparison may still call get()
+		sort_order.resize(entities.size());
 		for (unsigned int i = 0; i < entities.size(); i++)
-			map_entity_componentID[entities[i]] = i;
+			sort_order[i] = i;
+		std::sort(sort_order.begin(), sort_order.end(), [&](unsigned int a, unsigned int b) {
+			return comparisonFunction(entities[a], entities[b]);
+		});
+		reorder_entities(entities.size());
+		apply_entity_order(entities.size());
+	}
+
+	// Stable sort by a 64-bit key computed once per element, key(Entity, const Component&) -> uint64_t.
+	// Radix sort, linear in the number of components. Key bytes that all elements share are skipped,
+	// and an already sorted container is left untouched, so sorting every frame is cheap.
+	template <class KeyFunction>
+	void sort_by_key(KeyFunction key)
+	{
+		assert(!owning_group && "Sort owned containers through their group");
+		sort_keys.resize(components.size());
+		for (unsigned int i = 0; i < components.size(); i++)
+			sort_keys[i] = key(entities[i], components[i]);
+		if (std::is_sorted(sort_keys.begin(), sort_keys.end()))
+			return;
+		radix_sort_keys();
+		reorder_entities(entities.size());
+		apply_entity_order(entities.size());
+	}
+
+private:
+	template <typename... Owned>
+	friend class OwningGroup;
+
+	// Moves each of the first 'count' components to the position of its entity in the (already reordered) entity list.
+	// The sparse index still holds the old positions, so it describes the permutation; each cycle of
+	// the permutation is followed with a single temporary and the slots are updated on the way, which
+	// also marks them as done. Needs unique entities, as insert() without duplicates guarantees.
+	void apply_entity_order(size_t count)
+	{
+		for (unsigned int i = 0; i < count; i++)
+		{
+			unsigned int source = dense_index(entities[i].index());
+			if (source == i)
+				continue;
+			Component displaced = std::move(components[i]);
+			unsigned int j = i;
+			while (source != i)
+			{
+				components[j] = std::move(components[source]);
+				sparse_slot(entities[j].index()) = j;
+				j = source;
+				source = dense_index(entities[j].index());
+			}
+			components[j] = std::move(displaced);
+			sparse_slot(entities[j].index()) = j;
+		}
+	}
+};
+
+// Tags are empty structs, an entity either has one or it doesn't. Their container is a bitset over
+// entity indices plus the list of tagged entities, no components are stored. get() hands out one
+// shared instance.
+template <typename Component>
+class ComponentContainer<Component, typename std::enable_if<std::is_empty<Component>::value>::type>
+{
+	// Bit i of bits[i / 64] is set if the entity with index i has the tag
+	std::vector<uint64_t> bits;
+	// positions[i] is where the entity with index i is in 'entities', valid while its bit is set, so
+	// that removing is a swap with the last entity
+	std::vector<unsigned int> positions;
+
+	// See SparseSet
+	std::vector<Signature>* signatures = nullptr;
+	Signature signature_bit = 0;
+
+	inline static Component instance{};
+
+	bool test(unsigned int index) const
+	{
+		unsigned int word = index >> 6;
+		return word < bits.size() && ((bits[word] >> (index & 63)) & 1);
+	}
+
+public:
+	// The tagged entities, in no particular order
+	std::vector<Entity> entities;
+
+	void bind_signatures(std::vector<Signature>* table, unsigned int component_id)
+	{
+		assert(component_id < MAX_COMPONENT_TYPES);
+		signatures = table;
+		signature_bit = Signature(1) << component_id;
+	}
+
+	// Tagging an entity twice has no effect beyond the duplicate check
+	Component& insert(Entity e, Component = {}, bool check_for_duplicates = true)
+	{
+		assert(!(check_for_duplicates && has(e)) && "Entity already contained in ECS registry");
+		(void)check_for_duplicates;
+		if (has(e))
+			return instance;
+		unsigned int index = e.index();
+		if ((index >> 6) >= bits.size())
+			bits.resize((index >> 6) + 1, 0);
+		bits[index >> 6] |= uint64_t(1) << (index & 63);
+		if (index >= positions.size())
+			positions.resize(index + 1);
+		positions[index] = (unsigned int)entities.size();
+		entities.push_back(e);
+		if (signatures)
+		{
+			if (index >= signatures->size())
+				signatures->resize(index + 1, 0);
+			(*signatures)[index] |= signature_bit;
+		}
+		return instance;
+	}
+
+	template<typename... Args>
+	Component& emplace(Entity e, Args &&...) {
+		return insert(e);
+	};
+	template<typename... Args>
+	Component& emplace_with_duplicates(Entity e, Args &&...) {
+		return insert(e, {}, false);
+	};
+
+	Component& get(Entity e) {
+		assert(has(e) && "Entity not contained in ECS registry");
+		return instance;
+	}
+
+	// A bit test, the generation check rejects a stale handle whose index was re-used by a tagged entity
+	bool has(Entity e) const {
+		return test(e.index()) && Entity::is_alive(e);
+	}
+
+	bool contains(Entity e) const {
+		return has(e);
+	}
+
+	Component* find(Entity e) {
+		return has(e) ? &instance : nullptr;
+	}
+
+	void remove(Entity e)
+	{
+		if (!has(e))
+			return;
+		unsigned int index = e.index();
+		bits[index >> 6] &= ~(uint64_t(1) << (index & 63));
+		if (signatures)
+			(*signatures)[index] &= ~signature_bit;
+		unsigned int position = positions[index];
+		entities[position] = entities.back();
+		positions[entities[position].index()] = position;
+		entities.pop_back();
+	}
+
+	void clear()
+	{
+		for (Entity e : entities)
+		{
+			bits[e.index() >> 6] = 0;
+			if (signatures)
+				(*signatures)[e.index()] &= ~signature_bit;
+		}
+		entities.clear();
+	}
+
+	size_t size()
+	{
+		return entities.size();
+	}
+};
+
+// Component types excluded from a view, e.g. registry.view<Motion>(exclude<Background, Mouse>)
+template <typename... Excluded>
+struct exclude_t {};
+template <typename... Excluded>
+constexpr exclude_t<Excluded...> exclude{};
+
+// Iterates all entities that have every component in Components and none in Excluded.
+// The iteration is driven by the smallest of the included containers. Membership is a single test
+// of the entity's signature against the include and exclude masks, only the components that are
+// handed out are looked up. Ties go to the first listed component, so the draw order of a
+// view<RenderRequest, ...> follows the render requests.
+// Don't add or remove components of the viewed types while iterating, the packed arrays move.
+template <typename Includes, typename Excludes>
+class View;
+
+template <typename... Components, typename... Excluded>
+class View<std::tuple<Components...>, std::tuple<Excluded...>>
+{
+	std::tuple<ComponentContainer<Components>*...> includes;
+	const std::vector<Signature>* signatures;
+	Signature include_mask;
+	Signature filter_mask; // include_mask | exclude mask
+	const std::vector<Entity>* driver = nullptr;
+
+public:
+	View(std::tuple<ComponentContainer<Components>*...> includes_arg, const std::vector<Signature>* signatures_arg, Signature include_mask_arg, Signature exclude_mask_arg)
+		: includes(includes_arg), signatures(signatures_arg), include_mask(include_mask_arg), filter_mask(include_mask_arg | exclude_mask_arg)
+	{
+		static_assert(sizeof...(Components) > 0, "A view needs at least one component type");
+		((driver = (driver == nullptr || std::get<ComponentContainer<Components>*>(includes)->entities.size() < driver->size())
+			? &std::get<ComponentContainer<Components>*>(includes)->entities : driver), ...);
+	}
+
+	// Check if e passes the view's filter
+	bool contains(Entity e) const
+	{
+		return Entity::is_alive(e) && e.index() < signatures->size() && ((*signatures)[e.index()] & filter_mask) == include_mask;
+	}
+
+	// Component of a viewed entity
+	template <typename Component>
+	decltype(auto) get(Entity e)
+	{
+		return std::get<ComponentContainer<Component>*>(includes)->get(e);
+	}
+
+	// Upper bound of the number of entities in the view
+	size_t size_hint() const
+	{
+		return driver->size();
+	}
+
+	// Calls f(Entity, Components&...) for every entity in the view
+	template <typename Func>
+	void each(Func f)
+	{
+		const std::vector<Entity>& candidates = *driver;
+		for (size_t i = 0; i < candidates.size(); i++)
+		{
+			Entity e = candidates[i];
+			if (((*signatures)[e.index()] & filter_mask) != include_mask)
+				continue;
+			f(e, std::get<ComponentContainer<Components>*>(includes)->get(e)...);
+		}
+	}
+};
+
+// A persistent group over the containers of Owned. The entities that have every owned component are
+// kept at the front of each owned container, in the same order in all of them, so iterating the group
+// walks parallel packed arrays without any lookup. The order is maintained on every insert and remove
+// by swapping elements in or out of the front range. A container can be owned by only one group, and
+// inserting or removing an owned component may move other elements, including ones handed out by reference.
+template <typename... Owned>
+class OwningGroup : public GroupInterface
+{
+	static_assert(sizeof...(Owned) >= 2, "A group owns at least two component types");
+	static_assert(!(std::is_empty<Owned>::value || ...), "Tags have no packed array to group");
+
+	std::tuple<ComponentContainer<Owned>*...> owned;
+
+	// Number of members, the owned containers agree on their first 'length' entities
+	unsigned int length = 0;
+
+	typedef typename std::tuple_element<0, std::tuple<Owned...>>::type Lead;
+
+	ComponentContainer<Lead>& lead() {
+		return *std::get<0>(owned);
+	}
+
+	bool owns_all(Entity e) {
+		return (std::get<ComponentContainer<Owned>*>(owned)->has(e) && ...);
+	}
+
+	bool is_member(Entity e) {
+		return lead().has(e) && lead().index_of(e) < length;
+	}
+
+public:
+	OwningGroup(ComponentContainer<Owned>&... containers)
+		: owned(&containers...)
+	{
+		std::apply([this](auto*... container) {
+			((assert(!container->owning_group && "Container already owned by a group"), container->owning_group = this), ...);
+		}, owned);
+
+		// Gather the entities that already have every owned component
+		for (unsigned int i = 0; i < lead().entities.size(); i++)
+			on_insert(lead().entities[i]);
+	}
+	~OwningGroup()
+	{
+		std::apply([](auto*... container) { ((container->owning_group = nullptr), ...); }, owned);
+	}
+	// The containers point back at the group
+	OwningGroup(const OwningGroup&) = delete;
+	OwningGroup& operator=(const OwningGroup&) = delete;
+
+	void on_insert(Entity e) override
+	{
+		if (!owns_all(e) || is_member(e))
+			return;
+		std::apply([this, e](auto*... container) {
+			(container->swap_elements(container->index_of(e), length), ...);
+		}, owned);
+		length++;
+	}
+
+	void on_remove(Entity e) override
+	{
+		if (!is_member(e))
+			return;
+		length--;
+		std::apply([this, e](auto*... container) {
+			(container->swap_elements(container->index_of(e), length), ...);
+		}, owned);
+	}
+
+	void on_clear() override
+	{
+		length = 0;
+	}
+
+	size_t size() const {
+		return length;
+	}
+
+	// The members in group order, only the first size() entries belong to the group
+	const std::vector<Entity>& entities() {
+		return lead().entities;
+	}
+
+	// Calls f(Entity, Owned&...) for every member in group order.
+	// Don't add or remove owned components while iterating.
+	template <typename Function>
+	void each(Function f)
+	{
+		for (unsigned int i = 0; i < length; i++)
+			f(lead().entities[i], std::get<ComponentContainer<Owned>*>(owned)->components[i]...);
+	}
+
+	// Stable radix sort of the members by key(Entity, const Owned&...) -> uint64_t, see ComponentContainer::sort_by_key.
+	// Proxy storage hands the key its proxy, e.g. MotionRef, take that rather than a converted copy.
+	// The lead container is sorted, the other owned containers follow its entity order.
+	template <class KeyFunction>
+	void sort_by_key(KeyFunction key)
+	{
+		ComponentContainer<Lead>& first = lead();
+		first.sort_keys.resize(length);
+		for (unsigned int i = 0; i < length; i++)
+			first.sort_keys[i] = key(first.entities[i], std::get<ComponentContainer<Owned>*>(owned)->components[i]...);
+		if (std::is_sorted(first.sort_keys.begin(), first.sort_keys.end()))
+			return;
+		first.radix_sort_keys();
+		first.reorder_entities(length);
+		first.apply_entity_order(length);
+
+		std::apply([this, &first](auto*... container) {
+			((container != (void*)&first
+				? (std::copy(first.entities.begin(), first.entities.begin() + length, container->entities.begin()),
+					container->apply_entity_order(length))
+				: (void)0), ...);
+		}, owned);
+	}
+};
+
+template <typename... Components>
+class CommandBuffer;
+
+// Owns one ComponentContainer per component type in the type list and the entity signatures.
+// Container lookup is resolved at compile time, and clearing, teardown and debug listing expand
+// to a fold over the type list instead of virtual calls through a list of containers.
+template <typename... Components>
+class Registry
+{
+	std::tuple<ComponentContainer<Components>...> containers;
+
+	// Signature of every entity index, kept up to date by the containers
+	std::vector<Signature> signatures;
+
+public:
+	// Deferred structural changes for this registry, see CommandBuffer
+	typedef CommandBuffer<Components...> Commands;
+
+	static_assert(sizeof...(Components) <= MAX_COMPONENT_TYPES, "Too many component types for a Signature");
+
+	Registry()
+	{
+		(storage<Components>().bind_signatures(&signatures, component_id<Components>()), ...);
+	}
+	// The containers point into the registry's signature table
+	Registry(const Registry&) = delete;
+	Registry& operator=(const Registry&) = delete;
+
+	// Compile-time id of a component type, its position in the type list
+	template <typename Component>
+	static constexpr unsigned int component_id() {
+		return tuple_index<Component, std::tuple<Components...>>::value;
+	}
+
+	// Signature bits of a set of component types
+	template <typename... Subset>
+	static constexpr Signature mask() {
+		return (Signature(0) | ... | (Signature(1) << component_id<Subset>()));
+	}
+
+	// The container of a component type
+	template <typename Component>
+	ComponentContainer<Component>& storage() {
+		return std::get<ComponentContainer<Component>>(containers);
+	}
+
+	// The component of type 'Component' of entity e
+	template <typename Component>
+	decltype(auto) get(Entity e) {
+		return storage<Component>().get(e);
+	}
+
+	// The component types an entity has, empty for stale handles
+	Signature signature(Entity e) const {
+		if (!Entity::is_alive(e) || e.index() >= signatures.size())
+			return 0;
+		return signatures[e.index()];
+	}
+
+	// Check if the entity has every one of the component types with a single mask test
+	template <typename... Subset>
+	bool has_all(Entity e) const {
+		return (signature(e) & mask<Subset...>()) == mask<Subset...>();
+	}
+
+	// All entities with every component in Viewed, skipping those with any excluded component:
+	// registry.view<RenderRequest, Motion>(exclude<Background>).each([](Entity e, RenderRequest& rr, MotionRef m) {...});
+	template <typename... Viewed, typename... Excluded>
+	View<std::tuple<Viewed...>, std::tuple<Excluded...>> view(exclude_t<Excluded...> = {}) {
+		return { std::make_tuple(&storage<Viewed>()...), &signatures, mask<Viewed...>(), mask<Excluded...>() };
+	}
+
+	void clear_all_components() {
+		(storage<Components>().clear(), ...);
+	}
+
+	void list_all_components() {
+		printf("Debug info on all registry entries:\n");
+		((storage<Components>().size() > 0
+			? (void)printf("%4d components of type %s\n", (int)storage<Components>().size(), typeid(ComponentContainer<Components>).name())
+			: (void)0), ...);
+	}
+
+	void list_all_components_of(Entity e) {
+		printf("Debug info on components of entity %u:\n", (unsigned int)e);
+		Signature sig = signature(e);
+		(((sig & mask<Components>()) ? (void)printf("type %s\n", typeid(ComponentContainer<Components>).name()) : (void)0), ...);
+	}
+
+	// Removes every component of e and releases its handle for re-use
+	// Only the containers in the entity's signature are touched
+	void remove_all_components_of(Entity e) {
+		Signature sig = signature(e);
+		(((sig & mask<Components>()) ? storage<Components>().remove(e) : (void)0), ...);
+		Entity::destroy(e);
+	}
+};
+
+// Records structural changes while a system iterates the registry and applies them in one batch
+// at a sync point, so the containers being iterated never shift underneath the loop.
+// Playback order: removals (including those of destroyed entities), handle destruction, additions.
+// Removals are grouped per container and applied from the back of the packed array forward, so
+// each swap-and-pop moves an element that is not removed later in the same batch.
+template <typename... Components>
+class CommandBuffer
+{
+	std::tuple<std::vector<std::pair<Entity, Components>>...> additions;
+	std::vector<Entity> removals[sizeof...(Components)];
+	std::vector<Entity> destroyed;
+
+	template <typename Component>
+	static void apply_removals(ComponentContainer<Component>& container, std::vector<Entity>& pending) {
+		// Drop removals of components the entity no longer has
+		pending.erase(std::remove_if(pending.begin(), pending.end(), [&container](Entity e) {
+			return !container.has(e);
+		}), pending.end());
+		// Tags don't move anything on removal, there is nothing to order
+		if constexpr (!std::is_empty<Component>::value)
+			std::sort(pending.begin(), pending.end(), [&container](Entity a, Entity b) {
+				return container.index_of(a) > container.index_of(b);
+			});
+		else
+			std::sort(pending.begin(), pending.end(), [](Entity a, Entity b) { return (unsigned int)a < (unsigned int)b; });
+		pending.erase(std::unique(pending.begin(), pending.end()), pending.end());
+		for (Entity e : pending)
+			container.remove(e);
+		pending.clear();
+	}
+
+	template <typename Component>
+	static void apply_additions(ComponentContainer<Component>& container, std::vector<std::pair<Entity, Component>>& pending) {
+		for (auto& addition : pending) {
+			// The entity may have been destroyed after the addition was recorded
+			if (!Entity::is_alive(addition.first))
+				continue;
+			if (container.has(addition.first))
+				container.get(addition.first) = std::move(addition.second);
+			else
+				container.insert(addition.first, std::move(addition.second));
+		}
+		pending.clear();
+	}
+
+public:
+	// Handles are allocated right away, this touches no container and is safe during iteration
+	Entity create() {
+		return Entity::create();
+	}
+
+	void destroy(Entity e) {
+		destroyed.push_back(e);
+	}
+
+	template <typename Component>
+	void add(Entity e, Component c = {}) {
+		std::get<std::vector<std::pair<Entity, Component>>>(additions).emplace_back(e, std::move(c));
+	}
+
+	template <typename Component>
+	void remove(Entity e) {
+		removals[Registry<Components...>::template component_id<Component>()].push_back(e);
+	}
+
+	bool empty() const {
+		if (!destroyed.empty())
+			return false;
+		for (const std::vector<Entity>& pending : removals)
+			if (!pending.empty())
+				return false;
+		return std::apply([](const auto&... pending) { return (pending.empty() && ...); }, additions);
+	}
+
+	// Applies every recorded change to the registry and empties the buffer, keeping its capacity
+	void playback(Registry<Components...>& registry) {
+		// A destroyed entity loses exactly the components in its signature
+		for (Entity e : destroyed) {
+			Signature sig = registry.signature(e);
+			((sig & Registry<Components...>::template mask<Components>()
+				? removals[Registry<Components...>::template component_id<Components>()].push_back(e)
+				: (void)0), ...);
+		}
+
+		(apply_removals(registry.template storage<Components>(), removals[Registry<Components...>::template component_id<Components>()]), ...);
+
+		for (Entity e : destroyed)
+			Entity::destroy(e);
+		destroyed.clear();
+
+		(apply_additions(registry.template storage<Components>(), std::get<std::vector<std::pair<Entity, Components>>>(additions)), ...);
 	}
 };
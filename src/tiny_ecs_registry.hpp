@@ -5,90 +5,72 @@
 #include "components.hpp"
 #include "render_system.hpp"
 
-class ECSRegistry
-{
-	// Callbacks to remove a particular or all entities in the system
-	std::vector<ContainerInterface*> registry_list;
+// All component types this game has. A container for each one is created and registered by
+// Registry, the position in this list is the component's id in the entity signatures.
+typedef Registry<
+	DeathTimer,
+	Motion,
+	Gravity,
+	Player,
+	Virus,
+	Item,
+	Sickman,
+	Solid_Platform,
+	StaticBody,
+	DynamicBody,
+	KinematicBody,
+	Sleeping,
+	CollisionFilter,
+	Fighter,
+	Mesh*,
+	RenderRequest,
+	ScreenState,
+	vec3,
+	Background,
+	Ui,
+	MenuButton,
+	Mouse,
+	HelpComponent,
+	StoryComponent,
+	Battle,
+	HP_bar
+> GameRegistry;
 
+class ECSRegistry : public GameRegistry
+{
 public:
-	// Manually created list of all components this game has
-
-	ComponentContainer<DeathTimer> deathTimers;
-	ComponentContainer<Motion> motions;
-	ComponentContainer<Gravity> gravities;
-	ComponentContainer<Collision> collisions;
-	ComponentContainer<Player> players;
-	ComponentContainer<Virus> viruses;
-    ComponentContainer<Item> items;
-	ComponentContainer<Sickman> sickmen;
-	ComponentContainer<Solid_Platform> solid_platforms;
-	ComponentContainer<Fighter> fighters;
-	ComponentContainer<Mesh*> meshPtrs;
-	ComponentContainer<RenderRequest> renderRequests;
-	ComponentContainer<ScreenState> screenStates;
-	ComponentContainer<DebugComponent> debugComponents;
-	ComponentContainer<vec3> colors;
-    ComponentContainer<Background> backgrounds;
-	ComponentContainer<Ui> uis;
-	ComponentContainer<MenuButton> menuButtons;
-	ComponentContainer<Mouse> mouses;
-    ComponentContainer<HelpComponent> helpComponent;
-    ComponentContainer<StoryComponent> storyComponents;
-	ComponentContainer<Battle> battles;
-    ComponentContainer<HP_bar> hpbars;
-	// constructor that adds all containers for looping over them
-	// IMPORTANT: Don't forget to add any newly added containers!
-	ECSRegistry()
-	{
-		// TODO: A1 add a LightUp component
-		registry_list.push_back(&deathTimers);
-		registry_list.push_back(&motions);
-		registry_list.push_back(&gravities);
-		registry_list.push_back(&collisions);
-		registry_list.push_back(&players);
-		registry_list.push_back(&viruses);
-        registry_list.push_back(&items);
-        registry_list.push_back(&sickmen);
-		registry_list.push_back(&solid_platforms);
-		registry_list.push_back(&meshPtrs);
-		registry_list.push_back(&fighters);
-		registry_list.push_back(&renderRequests);
-		registry_list.push_back(&screenStates);
-		registry_list.push_back(&debugComponents);
-		registry_list.push_back(&colors);
-        registry_list.push_back(&backgrounds);
-		registry_list.push_back(&uis);
-		registry_list.push_back(&menuButtons);
-		registry_list.push_back(&mouses);
-		registry_list.push_back(&battles);
-        registry_list.push_back(&storyComponents);
-        registry_list.push_back(&helpComponent);
-        registry_list.push_back(&hpbars);
-	}
-
-	void clear_all_components() {
-		for (ContainerInterface* reg : registry_list)
-			reg->clear();
-	}
-
-	void list_all_components() {
-		printf("Debug info on all registry entries:\n");
-		for (ContainerInterface* reg : registry_list)
-			if (reg->size() > 0)
-				printf("%4d components of type %s\n", (int)reg->size(), typeid(*reg).name());
-	}
-
-	void list_all_components_of(Entity e) {
-		printf("Debug info on components of entity %u:\n", (unsigned int)e);
-		for (ContainerInterface* reg : registry_list)
-			if (reg->has(e))
-				printf("type %s\n", typeid(*reg).name());
-	}
+	// Named access to the containers, these refer into the registry's storage.
+	// Hot loops should prefer storage<T>() or view<T...>(), which resolve to a fixed offset.
+	ComponentContainer<DeathTimer>& deathTimers = storage<DeathTimer>();
+	ComponentContainer<Motion>& motions = storage<Motion>();
+	ComponentContainer<Gravity>& gravities = storage<Gravity>();
+	ComponentContainer<Player>& players = storage<Player>();
+	ComponentContainer<Virus>& viruses = storage<Virus>();
+	ComponentContainer<Item>& items = storage<Item>();
+	ComponentContainer<Sickman>& sickmen = storage<Sickman>();
+	ComponentContainer<Solid_Platform>& solid_platforms = storage<Solid_Platform>();
+	ComponentContainer<StaticBody>& staticBodies = storage<StaticBody>();
+	ComponentContainer<DynamicBody>& dynamicBodies = storage<DynamicBody>();
+	ComponentContainer<KinematicBody>& kinematicBodies = storage<KinematicBody>();
+	ComponentContainer<Sleeping>& sleepingBodies = storage<Sleeping>();
+	ComponentContainer<CollisionFilter>& collisionFilters = storage<CollisionFilter>();
+	ComponentContainer<Fighter>& fighters = storage<Fighter>();
+	ComponentContainer<Mesh*>& meshPtrs = storage<Mesh*>();
+	ComponentContainer<RenderRequest>& renderRequests = storage<RenderRequest>();
+	ComponentContainer<ScreenState>& screenStates = storage<ScreenState>();
+	ComponentContainer<vec3>& colors = storage<vec3>();
+	ComponentContainer<Background>& backgrounds = storage<Background>();
+	ComponentContainer<Ui>& uis = storage<Ui>();
+	ComponentContainer<MenuButton>& menuButtons = storage<MenuButton>();
+	ComponentContainer<Mouse>& mouses = storage<Mouse>();
+	ComponentContainer<HelpComponent>& helpComponent = storage<HelpComponent>();
+	ComponentContainer<StoryComponent>& storyComponents = storage<StoryComponent>();
+	ComponentContainer<Battle>& battles = storage<Battle>();
+	ComponentContainer<HP_bar>& hpbars = storage<HP_bar>();
 
-	void remove_all_components_of(Entity e) {
-		for (ContainerInterface* reg : registry_list)
-			reg->remove(e);
-	}
+	// Everything that is drawn, render requests and motions in lockstep at the front of both containers.
+	// Motion is owned here, so the containers can't be sorted on their own.
+	OwningGroup<RenderRequest, Motion> renderables{ renderRequests, motions };
 };
 
 extern ECSRegistry registry;
\ No newline at end of file
@@ -0,0 +1,82 @@
+// internal
+#include "worker_pool.hpp"
+
+WorkerPool::WorkerPool(unsigned int workers)
+	: worker_count(workers)
+{
+}
+
+WorkerPool::~WorkerPool()
+{
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		stopping = true;
+	}
+	wake.notify_all();
+	for (std::thread& thread : threads)
+		thread.join();
+}
+
+unsigned int WorkerPool::default_worker_count()
+{
+	// 0 if the number isn't known
+	unsigned int hardware = std::thread::hardware_concurrency();
+	return hardware > 1 ? hardware - 1 : 0;
+}
+
+void WorkerPool::parallel_for(size_t iterations, const std::function<void(size_t)>& function)
+{
+	if (worker_count == 0 || iterations <= 1)
+	{
+		for (size_t i = 0; i < iterations; i++)
+			function(i);
+		return;
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		if (threads.empty())
+			for (unsigned int i = 0; i < worker_count; i++)
+				threads.emplace_back(&WorkerPool::work, this);
+		task = &function;
+		count = iterations;
+		next = 0;
+		busy = worker_count;
+		loop++;
+	}
+	wake.notify_all();
+
+	run_iterations();
+
+	// Every worker has to be done with the loop before the task goes out of scope
+	std::unique_lock<std::mutex> lock(mutex);
+	done.wait(lock, [this] { return busy == 0; });
+	task = nullptr;
+}
+
+void WorkerPool::work()
+{
+	unsigned long last_loop = 0;
+	while (true)
+	{
+		{
+			std::unique_lock<std::mutex> lock(mutex);
+			wake.wait(lock, [this, last_loop] { return stopping || loop != last_loop; });
+			if (stopping)
+				return;
+			last_loop = loop;
+		}
+
+		run_iterations();
+
+		std::lock_guard<std::mutex> lock(mutex);
+		if (--busy == 0)
+			done.notify_one();
+	}
+}
+
+void WorkerPool::run_iterations()
+{
+	for (size_t i = next++; i < count; i = next++)
+		(*task)(i);
+}
@@ -0,0 +1,50 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// A fixed set of threads that work through the iterations of a loop together with the calling thread.
+// The threads are only started by the first loop that needs them and wait for the next loop in between.
+class WorkerPool
+{
+public:
+	// 'workers' threads besides the calling one, by default one less than the hardware runs at once
+	explicit WorkerPool(unsigned int workers = default_worker_count());
+	~WorkerPool();
+	WorkerPool(const WorkerPool&) = delete;
+	WorkerPool& operator=(const WorkerPool&) = delete;
+
+	// Calls task(i) for every i in [0, count) and returns once all calls have returned. The iterations
+	// are spread over the threads in no particular order, so a task must not depend on the order.
+	// Not reentrant, a task can't start another loop on the same pool.
+	void parallel_for(size_t count, const std::function<void(size_t)>& task);
+
+	// Threads a loop runs on, including the calling one
+	unsigned int thread_count() const { return worker_count + 1; }
+
+	static unsigned int default_worker_count();
+
+private:
+	unsigned int worker_count;
+	std::vector<std::thread> threads;
+
+	std::mutex mutex;
+	std::condition_variable wake; // a loop started or the pool is shutting down
+	std::condition_variable done; // the last worker finished its share of a loop
+	unsigned long loop = 0; // counts the loops started, a worker runs each one once
+	unsigned int busy = 0; // workers that haven't finished the current loop
+	bool stopping = false;
+
+	// The current loop, set while parallel_for runs
+	const std::function<void(size_t)>* task = nullptr;
+	size_t count = 0;
+	std::atomic<size_t> next{ 0 };
+
+	void work();
+	void run_iterations();
+};
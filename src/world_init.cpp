@@ -5,14 +5,14 @@
 
 Entity createPlayer(RenderSystem* renderer, vec2 position)
 {
-	auto entity = Entity();
+	auto entity = Entity::create();
 
 	// Store a reference to the potentially re-used mesh object (the value is stored in the resource cache)
 	Mesh& mesh = renderer->getMesh(GEOMETRY_BUFFER_ID::PLAYER);
 	registry.meshPtrs.emplace(entity, &mesh);
 
 	// Initialize the motion
-	auto& motion = registry.motions.emplace(entity);
+	auto motion = registry.motions.emplace(entity);
 	motion.angle = 0;
 	motion.velocity = { 0.f, 0.f };
 	motion.position = position;
@@ -24,6 +24,8 @@ Entity createPlayer(RenderSystem* renderer, vec2 position)
 	printf("%f %f", motion.scale.x, motion.scale.y);
 
 	auto& gravity = registry.gravities.emplace(entity);
+	registry.dynamicBodies.emplace(entity);
+	registry.collisionFilters.insert(entity, collision_filter(COLLISION_LAYER::PLAYER));
 	auto& player = registry.players.emplace(entity);
 	player.player_speed = 200.f;
 
@@ -42,14 +44,14 @@ Entity createPlayer(RenderSystem* renderer, vec2 position)
 
 Entity createVirus(RenderSystem* renderer, vec2 position, TEXTURE_ASSET_ID pathogen, bool in_combat)
 {
-	auto entity = Entity();
+	auto entity = Entity::create();
 
 	// Store a reference to the potentially re-used mesh object (the value is stored in the resource cache)
 	Mesh& mesh = renderer->getMesh(GEOMETRY_BUFFER_ID::ANIMATION);
 	registry.meshPtrs.emplace(entity, &mesh);
 
 	// Initialize the motion
-	auto& motion = registry.motions.emplace(entity);
+	auto motion = registry.motions.emplace(entity);
 	motion.angle = 0.f;
 	motion.velocity = { 0.f, 0.f };
 	motion.position = position;
@@ -58,6 +60,8 @@ Entity createVirus(RenderSystem* renderer, vec2 position, TEXTURE_ASSET_ID patho
 	Virus& virus = registry.viruses.emplace(entity);
 	virus.pathogen = pathogen;
 	virus.in_combat = in_combat;
+	registry.dynamicBodies.emplace(entity);
+	registry.collisionFilters.insert(entity, collision_filter(COLLISION_LAYER::ENEMY));
 
 	registry.renderRequests.insert(
 		entity,
@@ -86,14 +90,14 @@ Entity createVirus(RenderSystem* renderer, vec2 position, TEXTURE_ASSET_ID patho
 
 //Entity createBacteria(RenderSystem* renderer, vec2 position)
 //{
-//	auto entity = Entity();
+//	auto entity = Entity::create();
 //
 //	// Store a reference to the potentially re-used mesh object (the value is stored in the resource cache)
 //	Mesh& mesh = renderer->getMesh(GEOMETRY_BUFFER_ID::SPRITE);
 //	registry.meshPtrs.emplace(entity, &mesh);
 //
 //	// Initialize the motion
-//	auto& motion = registry.motions.emplace(entity);
+//	auto motion = registry.motions.emplace(entity);
 //	motion.angle = 0.f;
 //	motion.velocity = { 0.f, 0.f };
 //	motion.position = position;
@@ -113,14 +117,14 @@ Entity createVirus(RenderSystem* renderer, vec2 position, TEXTURE_ASSET_ID patho
 //
 //Entity createFungus(RenderSystem* renderer, vec2 position)
 //{
-//	auto entity = Entity();
+//	auto entity = Entity::create();
 //
 //	// Store a reference to the potentially re-used mesh object (the value is stored in the resource cache)
 //	Mesh& mesh = renderer->getMesh(GEOMETRY_BUFFER_ID::SPRITE);
 //	registry.meshPtrs.emplace(entity, &mesh);
 //
 //	// Initialize the motion
-//	auto& motion = registry.motions.emplace(entity);
+//	auto motion = registry.motions.emplace(entity);
 //	motion.angle = 0.f;
 //	motion.velocity = { 0.f, 0.f };
 //	motion.position = position;
@@ -140,14 +144,14 @@ Entity createVirus(RenderSystem* renderer, vec2 position, TEXTURE_ASSET_ID patho
 
 Entity createSickman(RenderSystem* renderer, vec2 position, Sickman::PATHOGEN_TYPE pathogen)
 {
-	auto entity = Entity();
+	auto entity = Entity::create();
 
 	// Store a reference to the potentially re-used mesh object (the value is stored in the resource cache)
 	Mesh& mesh = renderer->getMesh(GEOMETRY_BUFFER_ID::SPRITE);
 	registry.meshPtrs.emplace(entity, &mesh);
 
 	// Initialize the motion
-	auto& motion = registry.motions.emplace(entity);
+	auto motion = registry.motions.emplace(entity);
 	motion.angle = 0.f;
 	motion.velocity = { 0.f, 0.f };
 	motion.position = position;
@@ -168,31 +172,9 @@ Entity createSickman(RenderSystem* renderer, vec2 position, Sickman::PATHOGEN_TY
 	return entity;
 }
 
-Entity createLine(vec2 position, vec2 scale)
-{
-	Entity entity = Entity();
-
-	// Store a reference to the potentially re-used mesh object (the value is stored in the resource cache)
-	registry.renderRequests.insert(
-		entity,
-		{ TEXTURE_ASSET_ID::TEXTURE_COUNT,
-		 EFFECT_ASSET_ID::LINE,
-		 GEOMETRY_BUFFER_ID::DEBUG_LINE });
-
-	// Create motion
-	Motion& motion = registry.motions.emplace(entity);
-	motion.angle = 0.f;
-	motion.velocity = { 0, 0 };
-	motion.position = position;
-	motion.scale = scale;
-
-	registry.debugComponents.emplace(entity);
-	return entity;
-}
-
 Entity createHP(vec2 position)
 {
-    Entity entity = Entity();
+    Entity entity = Entity::create();
 
     // Store a reference to the potentially re-used mesh object (the value is stored in the resource cache)
     registry.renderRequests.insert(
@@ -202,7 +184,7 @@ Entity createHP(vec2 position)
               GEOMETRY_BUFFER_ID::HP_LINE });
 
     // Create motion
-    Motion& motion = registry.motions.emplace(entity);
+    MotionRef motion = registry.motions.emplace(entity);
     motion.angle = 0.f;
     motion.velocity = { 0, 0 };
     motion.position = position;
@@ -213,7 +195,7 @@ Entity createHP(vec2 position)
 }
 
 Entity createPlatform(vec2 pos, vec2 size) {
-	Entity entity = Entity();
+	Entity entity = Entity::create();
 
     registry.renderRequests.insert(
             entity,
@@ -221,18 +203,20 @@ Entity createPlatform(vec2 pos, vec2 size) {
              EFFECT_ASSET_ID::TEXTURED,
              GEOMETRY_BUFFER_ID::SPRITE });
 
-	auto& motion = registry.motions.emplace(entity);
+	auto motion = registry.motions.emplace(entity);
 	motion.position = pos;
 	motion.scale = size;
     motion.angle = 3.1415926f;
 
 	registry.solid_platforms.emplace(entity);
+	registry.staticBodies.emplace(entity);
+	registry.collisionFilters.insert(entity, collision_filter(COLLISION_LAYER::WORLD));
 	return entity;
 
 }
 
 Entity createHelpBox(vec2 pos, vec2 size) {
-    Entity entity = Entity();
+    Entity entity = Entity::create();
 
     registry.renderRequests.insert(
             entity,
@@ -240,7 +224,7 @@ Entity createHelpBox(vec2 pos, vec2 size) {
              EFFECT_ASSET_ID::TEXTURED,
              GEOMETRY_BUFFER_ID::SPRITE });
 
-    auto& motion = registry.motions.emplace(entity);
+    auto motion = registry.motions.emplace(entity);
     motion.position = pos;
     motion.scale = size;
     registry.helpComponent.emplace(entity);
@@ -248,7 +232,7 @@ Entity createHelpBox(vec2 pos, vec2 size) {
 }
 
 Entity createStoryBox(vec2 pos, vec2 size, TEXTURE_ASSET_ID story_board) {
-    Entity entity = Entity();
+    Entity entity = Entity::create();
 
     registry.renderRequests.insert(
         entity,
@@ -256,7 +240,7 @@ Entity createStoryBox(vec2 pos, vec2 size, TEXTURE_ASSET_ID story_board) {
          EFFECT_ASSET_ID::TEXTURED,
          GEOMETRY_BUFFER_ID::SPRITE });
 
-    auto& motion = registry.motions.emplace(entity);
+    auto motion = registry.motions.emplace(entity);
     motion.position = pos;
     motion.scale = size;
     registry.storyComponents.emplace(entity);
@@ -274,9 +258,9 @@ void createPlatformRow(int starting_width, int row_height, vec2 platform_scale,
 
 Entity createWall(int wall_num, int width, int height) {
 
-	Entity entity = Entity();
+	Entity entity = Entity::create();
 
-	auto& motion = registry.motions.emplace(entity);
+	auto motion = registry.motions.emplace(entity);
 	motion.angle = 0.f;
 	motion.velocity = { 0.f, 0.f };
 	switch (wall_num)
@@ -303,19 +287,21 @@ Entity createWall(int wall_num, int width, int height) {
 		break;
 	}
 	registry.solid_platforms.emplace(entity);
+	registry.staticBodies.emplace(entity);
+	registry.collisionFilters.insert(entity, collision_filter(COLLISION_LAYER::WORLD));
 	return entity;
 }
 
 Entity createButton(RenderSystem* renderer, vec2 position, MenuButton::Type type)
 {
-	auto entity = Entity();
+	auto entity = Entity::create();
 
 	// Store a reference to the potentially re-used mesh object (the value is stored in the resource cache)
 	Mesh& mesh = renderer->getMesh(GEOMETRY_BUFFER_ID::SPRITE);
 	registry.meshPtrs.emplace(entity, &mesh);
 
 	// Initialize the motion
-	auto& motion = registry.motions.emplace(entity);
+	auto motion = registry.motions.emplace(entity);
 	motion.position = position;
 
 	switch (type) {
@@ -329,6 +315,8 @@ Entity createButton(RenderSystem* renderer, vec2 position, MenuButton::Type type
 
     MenuButton & button = registry.menuButtons.emplace(entity);
     button.type = type;
+    registry.kinematicBodies.emplace(entity);
+    registry.collisionFilters.insert(entity, collision_filter(COLLISION_LAYER::UI));
 
 	TEXTURE_ASSET_ID texture_asset_id;
 
@@ -380,14 +368,14 @@ Entity createButton(RenderSystem* renderer, vec2 position, MenuButton::Type type
 
 Entity createVaccine(RenderSystem* renderer, vec2 position)
 {
-    auto entity = Entity();
+    auto entity = Entity::create();
 
     // Store a reference to the potentially re-used mesh object (the value is stored in the resource cache)
     Mesh& mesh = renderer->getMesh(GEOMETRY_BUFFER_ID::SPRITE);
     registry.meshPtrs.emplace(entity, &mesh);
 
     // Initialize the motion
-    auto& motion = registry.motions.emplace(entity);
+    auto motion = registry.motions.emplace(entity);
     motion.angle = 4.25f;
     motion.velocity = { 0.f, 0.f };
     motion.position = position;
@@ -395,6 +383,8 @@ Entity createVaccine(RenderSystem* renderer, vec2 position)
 
     motion.scale = vec2({VACCINE_BB_WIDTH, VACCINE_BB_HEIGHT });
     registry.items.emplace(entity);
+    registry.dynamicBodies.emplace(entity);
+    registry.collisionFilters.insert(entity, collision_filter(COLLISION_LAYER::ITEM));
 
     registry.renderRequests.insert(
             entity,
@@ -407,14 +397,14 @@ Entity createVaccine(RenderSystem* renderer, vec2 position)
 
 Entity createFireball(RenderSystem* renderer, vec2 position)
 {
-    auto entity = Entity();
+    auto entity = Entity::create();
 
     // Store a reference to the potentially re-used mesh object (the value is stored in the resource cache)
     Mesh& mesh = renderer->getMesh(GEOMETRY_BUFFER_ID::SPRITE);
     registry.meshPtrs.emplace(entity, &mesh);
 
     // Initialize the motion
-    auto& motion = registry.motions.emplace(entity);
+    auto motion = registry.motions.emplace(entity);
     motion.angle = 0.f;
     motion.velocity = { 0.f, 0.f };
     motion.position = position;
@@ -422,6 +412,8 @@ Entity createFireball(RenderSystem* renderer, vec2 position)
 
     motion.scale = vec2({FIREBALL_BB_WIDTH, FIREBALL_BB_HEIGHT });
     registry.items.emplace(entity);
+    registry.dynamicBodies.emplace(entity);
+    registry.collisionFilters.insert(entity, collision_filter(COLLISION_LAYER::ITEM));
 
     registry.renderRequests.insert(
             entity,
@@ -434,9 +426,9 @@ Entity createFireball(RenderSystem* renderer, vec2 position)
 
 Entity createMouse()
 {
-	Entity entity = Entity();
+	Entity entity = Entity::create();
 
-	registry.motions.emplace(entity);
+	// Not a body, clicks are found with a point query
 	registry.mouses.emplace(entity);
 
 	return entity;
@@ -444,7 +436,7 @@ Entity createMouse()
 
 Entity createUI()
 {
-	Entity entity = Entity();
+	Entity entity = Entity::create();
 
 	registry.uis.emplace(entity);
 
@@ -51,9 +51,6 @@ Entity createVirus(RenderSystem* renderer, vec2 position, TEXTURE_ASSET_ID patho
 
 Entity createSickman(RenderSystem* renderer, vec2 position, Sickman::PATHOGEN_TYPE pathogen);
 
-// a red line for debugging purposes
-Entity createLine(vec2 position, vec2 size);
-
 Entity createHP(vec2 position);
 
 // filler args, not sure what to fill in yet
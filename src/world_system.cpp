@@ -10,6 +10,7 @@
 #include "physics_system.hpp"
 #include "common.hpp"
 #include "components.hpp"
+#include "debug_draw.hpp"
 
 // Game configuration
 // TODO game configuration
@@ -34,6 +35,7 @@ WorldSystem::WorldSystem()
 	rng = std::default_random_engine(std::random_device()());
     virus_positions_cache = {};
     pathogen_types = {};
+    new_contacts.reserve(256);
 }
 
 WorldSystem::~WorldSystem() {
@@ -151,8 +153,9 @@ GLFWwindow* WorldSystem::create_window(int width, int height) {
 	return window;
 }
 
-void WorldSystem::init(RenderSystem* renderer_arg, int window_width_px, int window_height_px) {
+void WorldSystem::init(RenderSystem* renderer_arg, PhysicsSystem* physics_arg, int window_width_px, int window_height_px) {
 	this->renderer = renderer_arg;
+	this->physics = physics_arg;
 
 	// Playing background music indefinitely
 	Mix_PlayMusic(background_music, -1);
@@ -177,8 +180,7 @@ bool WorldSystem::step(float elapsed_ms_since_last_update) {
 	glfwSetWindowTitle(window, title_ss.str().c_str());
 
 	// Remove debug info from the last step
-	while (registry.debugComponents.entities.size() > 0)
-		registry.remove_all_components_of(registry.debugComponents.entities.back());
+	debug_draw.clear();
 
 	//TODO screen state
 	assert(registry.screenStates.components.size() <= 1);
@@ -355,8 +357,9 @@ bool WorldSystem::is_over() const {
 * Below Code contains Observer Patterns
 *****************************************************************************************/
 void WorldSystem::onNotify(Event event) {
-    if (event.type == Event::COLLISION) {
-        //handle_collisions(event.entity, event.entity_other);
+    // Only the start of a contact matters to the game, it is handled after the physics step, see handle_collisions
+    if (event.type == Event::COLLISION_BEGIN) {
+        new_contacts.push_back({ event.entity, event.entity_other, event.normal, event.depth });
     }
 }
 void WorldSystem::animate()
@@ -367,7 +370,7 @@ void WorldSystem::animate()
 	for (uint i = 0; i < registry.players.size(); i++) {
 		// !!! TODO: Decouple the motion component into smaller pieces
 		Entity entity_i = registry.players.entities[i];
-		Motion& motion_i = motion_registry.get(entity_i);
+		MotionRef motion_i = motion_registry.get(entity_i);
 				
 		switch (motion_i.current_state) {
 			case Motion::State::Idle:
@@ -384,168 +387,114 @@ void WorldSystem::animate()
 	
 }
 	// Compute collisions between entities
-        void WorldSystem::handle_collisions() {
-        // Loop over all collisions detected by the physics system
-        auto &collisionsRegistry = registry.collisions;
-        for (uint i = 0; i < collisionsRegistry.components.size(); i++) {
-            // The entity and its collider
-
-            Entity entity = collisionsRegistry.entities[i];
-            Entity entity_other = collisionsRegistry.components[i].other;
-
-            // For now, we are only interested in collisions that involve the player
-            if (registry.players.has(entity) && !registry.deathTimers.has(entity)) {
-                //Player& player = registry.players.get(entity);
-
-                // Checking Player - HardShell collisions
-                // Location of player and virus collision behaviour implementation
-                if (registry.viruses.has(entity_other)) {
-                    // initiate death unless already dying
-                    switch (registry.viruses.get(entity_other).pathogen) {
-                    case TEXTURE_ASSET_ID::VIRUS:
-                        changeState(LEVEL_STATE_COMBAT, false, Sickman::PATHOGEN_TYPE::VIRUS, entity_other);
-                        break;
-                    case TEXTURE_ASSET_ID::BACTERIA:
-                        changeState(LEVEL_STATE_COMBAT, false, Sickman::PATHOGEN_TYPE::BACTERIA, entity_other);
-                        break;
-                    case TEXTURE_ASSET_ID::FUNGUS:
-                        changeState(LEVEL_STATE_COMBAT, false, Sickman::PATHOGEN_TYPE::FUNGUS, entity_other);
-                        break;
-                    }
-
-                }
-                    // Checking Player - item collisions
-                else if (registry.items.has(entity_other)) {
-
-                    registry.remove_all_components_of(entity_other);
-                    Mix_PlayChannel(-1, player_get_item_sound, 0);
-                    ++points;
-
-                }
-
-            }
-            //Collisions with platforms
-            if (registry.solid_platforms.has(entity) && registry.gravities.has(entity_other) &&
-                !registry.players.has(entity_other)) {
-
-                Motion &motion_platform = registry.motions.get(entity);
-                Motion &motion_other = registry.motions.get(entity_other);
-
-                vec2 platform_pos = motion_platform.position;
-                vec2 platform_scale = get_bounding_box(motion_platform) / 2.f;
-
-                vec2 other_pos = motion_other.position;
-                vec2 other_scale = get_bounding_box(motion_other) / 2.f;
-
-                //A platform is below an object when the ypos of object is less than the platform posy
-
-                bool platform_below = other_pos.y < platform_pos.y;
-                bool platform_left = other_pos.x > platform_pos.x;
-
-                vec2 shortest_path_out_collision = {0.f, 0.f};
-                vec2 relative_distance;
-
-
-                //The asserts are to make sure that the values are positive and are within bounds
-
-                relative_distance.y =
-                        std::min(abs((other_pos.y + other_scale.y) - (platform_pos.y - platform_scale.y)),
-                                 abs((other_pos.y - other_scale.y) - (platform_pos.y + platform_scale.y)));
-                relative_distance.x =
-                        std::min(abs((other_pos.x - other_scale.x) - (platform_pos.x + platform_scale.x)),
-                                 abs((other_pos.x + other_scale.x) - (platform_pos.x - platform_scale.x)));
-
-                if (abs(relative_distance.x) < abs(relative_distance.y)) {
-                    if (platform_left) {
-                        shortest_path_out_collision.x += relative_distance.x;
-                    } else {
-                        shortest_path_out_collision.x -= relative_distance.x;
-                    }
-
-
-                } else {
-                    motion_other.velocity.y = 0;
-                    if (platform_below) {
-                        //registry.gravities.remove(entity_other);
+void WorldSystem::handle_collisions() {
+    // Every contact that began since the last call goes to the handlers of the component types involved,
+    // see ContactResponses. Removals are recorded in the command buffer and a combat start is deferred
+    // until all handlers ran, both would otherwise shift the containers being iterated.
+    combat_enemy = Entity();
+    combat_pathogen = Sickman::PATHOGEN_TYPE::NA;
+    // A pair can begin, end and begin again within the substeps of one step, it is handled once
+    remove_repeated_pairs(new_contacts);
+    contact_responses.dispatch(*this, new_contacts);
+    new_contacts.clear();
+    commands.playback(registry);
+
+    if (combat_pathogen != Sickman::PATHOGEN_TYPE::NA)
+        changeState(LEVEL_STATE_COMBAT, false, combat_pathogen, combat_enemy);
+}
 
-                        shortest_path_out_collision.y -= relative_distance.y;
-                    } else {
-                        shortest_path_out_collision.y += relative_distance.y;
-                    }
+// Location of player and virus collision behaviour implementation
+void WorldSystem::on_player_virus(const std::vector<Contact>& contacts) {
+    for (const Contact& contact : contacts) {
+        Entity entity_other = contact.second;
+        // The first virus run into starts the combat
+        switch (registry.viruses.get(entity_other).pathogen) {
+        case TEXTURE_ASSET_ID::VIRUS:
+            combat_pathogen = Sickman::PATHOGEN_TYPE::VIRUS;
+            break;
+        case TEXTURE_ASSET_ID::BACTERIA:
+            combat_pathogen = Sickman::PATHOGEN_TYPE::BACTERIA;
+            break;
+        case TEXTURE_ASSET_ID::FUNGUS:
+            combat_pathogen = Sickman::PATHOGEN_TYPE::FUNGUS;
+            break;
+        default:
+            break;
+        }
+        combat_enemy = entity_other;
+        if (combat_pathogen != Sickman::PATHOGEN_TYPE::NA)
+            break;
+    }
+}
 
-                }
+void WorldSystem::on_player_item(const std::vector<Contact>& contacts) {
+    for (const Contact& contact : contacts) {
+        commands.destroy(contact.second);
+        Mix_PlayChannel(-1, player_get_item_sound, 0);
+        ++points;
+    }
+}
 
-                motion_other.position += shortest_path_out_collision;
-            }
-                //Check mouse collisions
-                if (registry.mouses.has(entity)) {
-                    if (registry.menuButtons.has(entity_other)) {
-                        auto button_type = registry.menuButtons.get(entity_other).type;
-                        printf("%d\n", button_type);
-                        if (registry.battles.get(registry.players.entities[0]).current_state ==
-                            COMBAT_STATE::WAIT) {
-                            Battle& battle = registry.battles.get(registry.players.entities[0]);
-
-                            switch (button_type) {
-                                case MenuButton::Type::FIGHT:
-                                    registry.uis.get(UI).current_state = Ui::State::FIGHT;
-                                    break;
-                                case MenuButton::Type::BACK:
-                                    registry.uis.get(UI).current_state = Ui::State::MAIN;
-                                    break;
-                                case MenuButton::Type::RUN:
-                                    battle.action = PLAYER_ACTION::RUN;
-                                    break;
-                                case MenuButton::Type::ALLIES:
-                                    registry.uis.get(UI).current_state = Ui::State::ALLIES;
-                                    break;
-                                case MenuButton::Type::ITEMS:
-                                    registry.uis.get(UI).current_state = Ui::State::ITEMS;
-                                    break;
-                                case MenuButton::Type::PUNCH:
-                                     if (battle.action == PLAYER_ACTION::IDLE) {
-                                        registry.uis.get(UI).current_state = Ui::State::MAIN;
+void WorldSystem::on_pointer_button(const std::vector<Contact>& contacts) {
+    for (const Contact& contact : contacts) {
+        Entity entity_other = contact.second;
+        auto button_type = registry.menuButtons.get(entity_other).type;
+        printf("%d\n", button_type);
+        if (registry.battles.get(registry.players.entities[0]).current_state ==
+            COMBAT_STATE::WAIT) {
+            Battle& battle = registry.battles.get(registry.players.entities[0]);
+
+            switch (button_type) {
+                case MenuButton::Type::FIGHT:
+                    registry.uis.get(UI).current_state = Ui::State::FIGHT;
+                    break;
+                case MenuButton::Type::BACK:
+                    registry.uis.get(UI).current_state = Ui::State::MAIN;
+                    break;
+                case MenuButton::Type::RUN:
+                    battle.action = PLAYER_ACTION::RUN;
+                    break;
+                case MenuButton::Type::ALLIES:
+                    registry.uis.get(UI).current_state = Ui::State::ALLIES;
+                    break;
+                case MenuButton::Type::ITEMS:
+                    registry.uis.get(UI).current_state = Ui::State::ITEMS;
+                    break;
+                case MenuButton::Type::PUNCH:
+                     if (battle.action == PLAYER_ACTION::IDLE) {
+                        registry.uis.get(UI).current_state = Ui::State::MAIN;
 //                                        registry.menuButtons.get(entity_other).type = MenuButton::Type::MAIN;
-                                        battle.action = PLAYER_ACTION::ATTACK;
-                                        curr_player_attack.attack_type = Attack::ATTACK_TYPE::OFFENCE;
-                                        curr_player_attack.name = "PUNCH";
-                                        curr_player_attack.base_dmg = 25;
-                                     }
-                                    break;
-                                case MenuButton::Type::SHOOT:
-                                     if (battle.action == PLAYER_ACTION::IDLE) {
-                                        registry.uis.get(UI).current_state = Ui::State::MAIN;
+                        battle.action = PLAYER_ACTION::ATTACK;
+                        curr_player_attack.attack_type = Attack::ATTACK_TYPE::OFFENCE;
+                        curr_player_attack.name = "PUNCH";
+                        curr_player_attack.base_dmg = 25;
+                     }
+                    break;
+                case MenuButton::Type::SHOOT:
+                     if (battle.action == PLAYER_ACTION::IDLE) {
+                        registry.uis.get(UI).current_state = Ui::State::MAIN;
 //                                        registry.menuButtons.get(entity_other).type = MenuButton::Type::MAIN;
-                                        battle.action = PLAYER_ACTION::ATTACK;
-                                        curr_player_attack.attack_type = Attack::ATTACK_TYPE::OFFENCE;
-                                        curr_player_attack.name = "SHOOT";
-                                        curr_player_attack.base_dmg = 35;
-                                     }
-                                    break;
-                                case MenuButton::Type::HEAT:
-                                     if (battle.action == PLAYER_ACTION::IDLE) {
-                                        registry.uis.get(UI).current_state = Ui::State::MAIN;
+                        battle.action = PLAYER_ACTION::ATTACK;
+                        curr_player_attack.attack_type = Attack::ATTACK_TYPE::OFFENCE;
+                        curr_player_attack.name = "SHOOT";
+                        curr_player_attack.base_dmg = 35;
+                     }
+                    break;
+                case MenuButton::Type::HEAT:
+                     if (battle.action == PLAYER_ACTION::IDLE) {
+                        registry.uis.get(UI).current_state = Ui::State::MAIN;
 //                                        registry.menuButtons.get(entity_other).type = MenuButton::Type::MAIN;
-                                        battle.action = PLAYER_ACTION::ATTACK;
-                                        curr_player_attack.attack_type = Attack::ATTACK_TYPE::OFFENCE;
-                                        curr_player_attack.name = "HEAT";
-                                        curr_player_attack.base_dmg = 30;
-                                     }
-                                    break;
-                            }
-                            updateUI();
-                        }
-                    }
-
-                }
-
-
+                        battle.action = PLAYER_ACTION::ATTACK;
+                        curr_player_attack.attack_type = Attack::ATTACK_TYPE::OFFENCE;
+                        curr_player_attack.name = "HEAT";
+                        curr_player_attack.base_dmg = 30;
+                     }
+                    break;
             }
-            registry.collisions.clear();
-
-
-
+            updateUI();
+        }
     }
+}
 
 void WorldSystem::toggle_help() {
     if (help.in_help_mode) {
@@ -574,11 +523,13 @@ void WorldSystem::on_key(int key, int, int action, int mod) {
 
         // Movement with WASD
         Entity& player = registry.players.entities[0];
-        Motion& motion = registry.motions.get(player);
+        MotionRef motion = registry.motions.get(player);
         float player_speed = registry.players.get(player).player_speed;
         bool ladder = false;
 
         if (!registry.deathTimers.has(player)) {
+            // The player may have fallen asleep standing still
+            wake_up(player);
             switch (key) {
             case GLFW_KEY_W:	// Move up or jump
                 if ((action == GLFW_PRESS || action == GLFW_REPEAT) && ladder) {
@@ -655,6 +606,12 @@ void WorldSystem::on_key(int key, int, int action, int mod) {
             debugging.in_debug_mode = true;
     }
 
+    // Cycle the collision broadphase, to compare them while playing
+    if (key == GLFW_KEY_B && action == GLFW_RELEASE) {
+        debugging.broadphase = (BROADPHASE)(((int)debugging.broadphase + 1) % broadphase_count);
+        printf("Broadphase: %s\n", broadphase_name(debugging.broadphase));
+    }
+
     // Help
     if (key == GLFW_KEY_H) {
         if (action == GLFW_RELEASE) {
@@ -722,11 +679,6 @@ void WorldSystem::on_key(int key, int, int action, int mod) {
 void WorldSystem::on_mouse_move(vec2 mouse_position) {
 
     this->mouse_position = mouse_position;
-    if (registry.mouses.has(mouse)) {
-        registry.motions.get(mouse).position = mouse_position;       
-    }
-
-
 }
 
 
@@ -735,20 +687,13 @@ void WorldSystem::on_mouse_input(int button, int action, int mods)
 
   if (button == GLFW_MOUSE_BUTTON_LEFT && action == GLFW_PRESS) {
 
-      Motion& motion_mouse = registry.motions.get(mouse);
-      Entity entity_j = mouse;
-      //Iterate through all buttons and check for collision
-      if (registry.menuButtons.size() > 0) {
-        for (uint i = 0; i < registry.menuButtons.size(); i++) {
-          Entity entity_i = registry.menuButtons.entities[i];
-          Motion& motion_button = registry.motions.get(entity_i);
-
-          if (collides(motion_mouse, motion_button) && i != 0) {
-
-            registry.collisions.emplace_with_duplicates(entity_i, entity_j);
-            registry.collisions.emplace_with_duplicates(entity_j, entity_i);
-
-          }
+      // The button under the pointer, except the first, which is the panel the others sit next to.
+      // Pressing a button rebuilds the menu, so only one is pressed per click.
+      physics->queryPoint(mouse_position, layer_bit(COLLISION_LAYER::UI), clicked);
+      for (Entity entity : clicked) {
+        if (registry.menuButtons.has(entity) && entity != registry.menuButtons.entities[0]) {
+          new_contacts.push_back({ mouse, entity });
+          break;
         }
       }
 
@@ -816,30 +761,30 @@ void WorldSystem::changeState(unsigned int new_state, bool win, Sickman::PATHOGE
         //Delete all virus entities
         for (int i = 0; i < registry.viruses.size(); i++) {
             if (registry.viruses.components[i].in_combat)
-                registry.remove_all_components_of(registry.viruses.entities[i]);
+                commands.destroy(registry.viruses.entities[i]);
             else
-                registry.renderRequests.remove(registry.viruses.entities[i]);
+                commands.remove<RenderRequest>(registry.viruses.entities[i]);
         }
+        commands.playback(registry);
 
 
+        // Creating and removing drawable entities reorders the motions, the player's motion is looked up where it is used
         Entity player = registry.players.entities[0];
-        Motion &player_motion = registry.motions.get(player);
 
         if (new_state == LEVEL_STATE_SELECTOR) {
             // TODO: Find reason for returning to level selector: win or death
 
-            if (!registry.items.entities.empty()) {
-                for (Entity entity : registry.items.entities) {
-                    registry.remove_all_components_of(entity);
-                }
+            for (Entity entity : registry.items.entities) {
+                commands.destroy(entity);
             }
 
             if (registry.battles.components.size() > 0) {
                 if (win) {
-                    registry.remove_all_components_of(registry.battles.components[0].enemy);
-                    registry.remove_all_components_of(overworld_enemy);
+                    commands.destroy(registry.battles.components[0].enemy);
+                    commands.destroy(overworld_enemy);
                 }
             }
+            commands.playback(registry);
             registry.battles.clear();
 
             for (int i = 0; i < registry.viruses.size(); i++) {
@@ -878,6 +823,7 @@ void WorldSystem::changeState(unsigned int new_state, bool win, Sickman::PATHOGE
             }
 
             // Move player to correct coordinates
+            MotionRef player_motion = registry.motions.get(player);
             if (win) {
                 player_motion.position = player_position;
                 std::vector<vec2>::iterator iter_v;
@@ -920,20 +866,22 @@ void WorldSystem::changeState(unsigned int new_state, bool win, Sickman::PATHOGE
             }
             if (!registry.gravities.has(player))
                 registry.gravities.emplace(player);
+            wake_up(player);
             registry.uis.get(UI).current_state = Ui::State::NONE;
 
 
             for (Entity entity: registry.sickmen.entities) {
-                registry.remove_all_components_of(entity);
+                commands.destroy(entity);
             }
 
             for (Entity entity: registry.hpbars.entities) {
-                registry.remove_all_components_of(entity);
+                commands.destroy(entity);
             }
 
             for (Entity entity : registry.viruses.entities) {
-                registry.remove_all_components_of(entity);
+                commands.destroy(entity);
             }
+            commands.playback(registry);
 
             for (int i = 0; i < virus_positions_cache.size(); i++) {
                 createVirus(renderer, virus_positions_cache[i], pathogen_types[i], false);
@@ -949,6 +897,7 @@ void WorldSystem::changeState(unsigned int new_state, bool win, Sickman::PATHOGE
 
 
             // Save player coordinates in overworld
+            MotionRef player_motion = registry.motions.get(player);
             player_position = {player_motion.position.x, player_motion.position.y};
             // Move player to correct coordinates
             player_motion.position = {game_w / 5, game_h - abs(player_motion.scale.y) / 2};
@@ -967,13 +916,14 @@ void WorldSystem::changeState(unsigned int new_state, bool win, Sickman::PATHOGE
 //            createVirus(renderer, { game_w - 50, game_h - abs(VIRUS_BB_HEIGHT) / 2 });
             Entity enemy = createSickman(renderer, {game_w - 250, (game_h - abs(SICKMAN_BB_HEIGHT) / 2)}, pathogen);
 
-            Motion& overworld_enemy_motion = registry.motions.get(overworld_enemy);
+            MotionRef overworld_enemy_motion = registry.motions.get(overworld_enemy);
             defeated_virus_position = overworld_enemy_motion.position;
             startBattle(enemy, overworld_enemy);
 
             for (Entity entity : registry.viruses.entities) {
-                registry.remove_all_components_of(entity);
+                commands.destroy(entity);
             }
+            commands.playback(registry);
 
             switch (pathogen) {
             case Sickman::PATHOGEN_TYPE::VIRUS:
@@ -1090,11 +1040,10 @@ void WorldSystem::resolveCombat() {
     case COMBAT_STATE::UPDATE_ENEMY_STATS:
         // Check what item was used/what attack was done on enemy and update HP accordingly
         if (prev_state == COMBAT_STATE::ATTACK) {
-            if (!registry.items.entities.empty()) {
-                for (Entity entity : registry.items.entities) {
-                    registry.remove_all_components_of(entity);
-                }
+            for (Entity entity : registry.items.entities) {
+                commands.destroy(entity);
             }
+            commands.playback(registry);
             if (battle.curr_player_attack.name == "PUNCH") {
                 registry.sickmen.get(enemy).sick = true;
                 registry.sickmen.get(enemy).fire = false;
@@ -1325,7 +1274,7 @@ void WorldSystem::startBattle(Entity enemy, Entity overworld_enemy) {
     vec3 multipliers = {1.0, 1.0, 1.0};
     std::vector<Attack> attacks = {};
     if (registry.motions.has(overworld_enemy)) {
-        Motion& overworld_enemy_motion = registry.motions.get(overworld_enemy);    
+        MotionRef overworld_enemy_motion = registry.motions.get(overworld_enemy);    
         multipliers = getEnemyMultipliers(j, overworld_enemy_motion.position.x, overworld_enemy_motion.position.y);
         printf("DamageReduction: %f\n", multipliers[0]);
         printf("DamageMultiplier: %f\n", multipliers[1]);
@@ -18,6 +18,8 @@
 #include "json_parser.hpp"
 #include "nlohmann/json.hpp"
 #include "save_load.hpp"
+#include "contact_dispatch.hpp"
+#include "physics_system.hpp"
 
 
 using json = nlohmann::json;
@@ -34,7 +36,7 @@ public:
 	GLFWwindow* create_window(int width, int height);
 
 	// starts the game
-	void init(RenderSystem* renderer, int window_width_px, int window_height_px);
+	void init(RenderSystem* renderer, PhysicsSystem* physics, int window_width_px, int window_height_px);
 
 	// Releases all associated resources
 	~WorldSystem();
@@ -90,8 +92,34 @@ private:
 	bool wait = false;
 	
 
+	// Structural changes made while iterating the registry, applied at the end of the step that made them
+	ECSRegistry::Commands commands;
+
+	// Contacts that began since the last handle_collisions, over all substeps of a step. Cleared, not freed, after
+	// they are handled, so recording them doesn't allocate once the capacity has grown.
+	std::vector<Contact> new_contacts;
+	// The bodies under the pointer when it was last clicked
+	std::vector<Entity> clicked;
+
+	// Collision responses, each gets the contacts between the two kinds of entities it is for. In a
+	// contact the first entity is the one of the first type.
+	void on_player_virus(const std::vector<Contact>& contacts);
+	void on_player_item(const std::vector<Contact>& contacts);
+	void on_pointer_button(const std::vector<Contact>& contacts);
+	typedef ContactDispatch<
+		OnContact<Player, Virus, &WorldSystem::on_player_virus, exclude_t<DeathTimer>>,
+		OnContact<Player, Item, &WorldSystem::on_player_item, exclude_t<DeathTimer>>,
+		OnContact<Mouse, MenuButton, &WorldSystem::on_pointer_button>
+	> ContactResponses;
+	ContactResponses contact_responses;
+
+	// The combat a handler started, begun once the contacts are handled
+	Entity combat_enemy;
+	Sickman::PATHOGEN_TYPE combat_pathogen = Sickman::PATHOGEN_TYPE::NA;
+
 	// TODO Game state
 	RenderSystem* renderer;
+	PhysicsSystem* physics;
 	float current_speed;
 	float next_virus_spawn;
 	vec2 mouse_position;